@@ -69,6 +69,7 @@
 #include "Analyze.h"
 #include "Stats.h"
 #include "VCode.h"
+#include "ShardRun.h"
 #include "AES.h"
 #include "version.h"
 
@@ -94,6 +95,10 @@
 #include "SeedAvalancheTest.h"
 #include "SeedBitIndependenceTest.h"
 #include "BadSeedsTest.h"
+#include "BloomFilterTest.h"
+#include "SketchTest.h"
+#include "ShardingTest.h"
+#include "PartitionTest.h"
 
 #include <cstdio>
 #include <cstdint>
@@ -142,6 +147,10 @@ static bool g_testPerlinNoise;
 static bool g_testBitflip;
 static bool g_testBIC;
 static bool g_testBadSeeds;
+static bool g_testBloomFilter;
+static bool g_testSketch;
+static bool g_testSharding;
+static bool g_testPartition;
 
 struct TestOpts {
     bool &       var;
@@ -177,6 +186,10 @@ static TestOpts g_testopts[] = {
     { g_testBitflip,          true,     false,    "Bitflip" },
     { g_testBIC,              true,     false,    "BIC" },
     { g_testBadSeeds,        false,     false,    "BadSeeds" },
+    { g_testBloomFilter,     false,     false,    "BloomFilter" },
+    { g_testSketch,          false,     false,    "Sketch" },
+    { g_testSharding,        false,     false,    "Sharding" },
+    { g_testPartition,       false,     false,    "Partition" },
 };
 
 static void set_default_tests( bool enable ) {
@@ -399,6 +412,8 @@ static bool test( const HashInfo * hInfo, const flags_t flags ) {
         exit(1);
     }
 
+    ShardInit(hInfo, g_testExtra);
+
     //-----------------------------------------------------------------------------
     // Some hashes only take 32-bits of seed data, so there's no way of
     // getting big seeds to them at all.
@@ -623,11 +638,51 @@ static bool test( const HashInfo * hInfo, const flags_t flags ) {
         if (!result && g_exitOnFailure) { goto out; }
     }
 
+    //-----------------------------------------------------------------------------
+    // Bloom filter false-positive rates and speed
+
+    if (g_testBloomFilter) {
+        result &= BloomFilterTest<hashtype>(hInfo, g_testExtra, flags);
+        if (g_dumpAllVCodes) { DumpVCodes(); }
+        if (!result && g_exitOnFailure) { goto out; }
+    }
+
+    //-----------------------------------------------------------------------------
+    // HyperLogLog and count-min sketch accuracy and speed
+
+    if (g_testSketch) {
+        result &= SketchTest<hashtype>(hInfo, g_testExtra, flags);
+        if (g_dumpAllVCodes) { DumpVCodes(); }
+        if (!result && g_exitOnFailure) { goto out; }
+    }
+
+    //-----------------------------------------------------------------------------
+    // Load balance of sharding and consistent-hashing schemes
+
+    if (g_testSharding) {
+        result &= ShardingTest<hashtype>(hInfo, g_testExtra, flags);
+        if (g_dumpAllVCodes) { DumpVCodes(); }
+        if (!result && g_exitOnFailure) { goto out; }
+    }
+
+    //-----------------------------------------------------------------------------
+    // Radix-partitioning throughput and partition skew
+
+    if (g_testPartition) {
+        result &= PartitionTest<hashtype>(hInfo, g_testExtra, flags);
+        if (g_dumpAllVCodes) { DumpVCodes(); }
+        if (!result && g_exitOnFailure) { goto out; }
+    }
+
     //-----------------------------------------------------------------------------
     // If All material tests were done, show a final summary of testing
     summary |= g_testAll;
 
  out:
+    // The shard run finished, either by running every test it was asked
+    // to or by stopping at a failure, so its results can be merged.
+    ShardFinish();
+
     if (summary) {
         printf("----------------------------------------------------------------------------------------------\n");
         print_pvaluecounts();
@@ -704,7 +759,9 @@ static void usage( void ) {
            "                 [--seed=<hash_default_seed>] [--randseed=<RNG_base_seed>]\n"
            "                 [--endian=default|nondefault|native|nonnative|big|little]\n"
            "                 [--[no]exit-on-failure] [--[no]exit-code-on-failure]\n"
-           "                 [--vcode[-all]] [--[no]time-tests]\n"
+           "                 [--vcode[-all]] [--[no]time-tests] [--max-memory=<N>[K|M|G]]\n"
+           "                 [--[no]screen] [--resume=<checkpoint_file>]\n"
+           "                 [--shard=<i>/<N>,<shard_file>] [--merge=<shard_file>[,...]]\n"
            "                 [<hashname>]\n"
            "\n"
            "       SMHasher3 [--list]|[--listnames]|[--tests]|[--version]\n"
@@ -820,6 +877,14 @@ int main( int argc, const char ** argv ) {
                 g_showTestTimes = false;
                 continue;
             }
+            if (strcmp(arg, "--screen") == 0) {
+                g_screenHashes = true;
+                continue;
+            }
+            if (strcmp(arg, "--noscreen") == 0) {
+                g_screenHashes = false;
+                continue;
+            }
             if (strcmp(arg, "--extra") == 0) {
                 g_testExtra = true;
                 continue;
@@ -850,6 +915,69 @@ int main( int argc, const char ** argv ) {
                 Rand::GLOBAL_SEED = seed;
                 continue;
             }
+            if (strncmp(arg, "--max-memory=", 13) == 0) {
+                errno = 0;
+                char *   endptr;
+                uint64_t maxmem = strtoull(&arg[13], &endptr, 0);
+                switch (*endptr) {
+                case 'G': case 'g': maxmem <<= 10; // FALLTHROUGH
+                case 'M': case 'm': maxmem <<= 10; // FALLTHROUGH
+                case 'K': case 'k': maxmem <<= 10; endptr++; break;
+                }
+                if ((errno != 0) || (arg[13] == '\0') || (*endptr != '\0')) {
+                    printf("Error parsing memory limit \"%s\"\n", &arg[13]);
+                    exit(1);
+                }
+                g_maxMemory = maxmem;
+                continue;
+            }
+            if (strncmp(arg, "--resume=", 9) == 0) {
+                if (arg[9] == '\0') {
+                    printf("Error: --resume needs a checkpoint file name\n");
+                    exit(1);
+                }
+                g_resumeFile = &arg[9];
+                continue;
+            }
+            if (strncmp(arg, "--shard=", 8) == 0) {
+                errno = 0;
+                char *   endptr;
+                unsigned long index = strtoul(&arg[8], &endptr, 0);
+                unsigned long count = 0;
+                if ((errno == 0) && (endptr != &arg[8]) && (*endptr == '/')) {
+                    const char * countptr = endptr + 1;
+                    count = strtoul(countptr, &endptr, 0);
+                    if (endptr == countptr) {
+                        count = 0;
+                    }
+                }
+                if ((errno != 0) || (count == 0) || (count > 65536) || (index >= count) ||
+                        (*endptr != ',') || (endptr[1] == '\0')) {
+                    printf("Error parsing shard specification \"%s\"\n", &arg[8]);
+                    exit(1);
+                }
+                g_shardIndex = index;
+                g_shardCount = count;
+                g_shardFile  = endptr + 1;
+                continue;
+            }
+            if (strncmp(arg, "--merge=", 8) == 0) {
+                const char * name = &arg[8];
+                const char * next;
+                do {
+                    next = strchr(name, ',');
+                    const std::string filename = (next == NULL) ? name : std::string(name, next - name);
+                    if (filename.empty()) {
+                        printf("Error parsing shard file list \"%s\"\n", &arg[8]);
+                        exit(1);
+                    }
+                    g_mergeFiles.push_back(filename);
+                    if (next != NULL) {
+                        name = next + 1;
+                    }
+                } while (next != NULL);
+                continue;
+            }
             if (strncmp(arg, "--ncpu=", 7) == 0) {
 #if defined(HAVE_THREADS)
                 errno = 0;
@@ -887,6 +1015,7 @@ int main( int argc, const char ** argv ) {
             }
             if (strcmp(arg, "--InternalTests") == 0) {
                 TestAESWrappers();
+                BlobTest();
                 BlobsortTest();
                 RandTest(5);
                 exit(0);
@@ -895,6 +1024,11 @@ int main( int argc, const char ** argv ) {
                 BlobsortBenchmark();
                 exit(0);
             }
+            if (strcmp(arg, "--BlobBench") == 0) {
+                BlobTest();
+                BlobBenchmark();
+                exit(0);
+            }
             if (strcmp(arg, "--RandBench") == 0) {
                 RandTest(1);
                 RandBenchmark();
@@ -909,6 +1043,17 @@ int main( int argc, const char ** argv ) {
         hashToTest = arg;
     }
 
+    // Only the Bitflip and BadSeeds tests split up and merge their work.
+    // All other tests are run in full in every shard and in the merge.
+    if (ShardPartial() && ShardMerging()) {
+        printf("Error: --shard and --merge cannot be used together\n");
+        exit(1);
+    }
+    if (ShardMerging() && (g_resumeFile != NULL)) {
+        printf("Error: --resume and --merge cannot be used together\n");
+        exit(1);
+    }
+
     bool   result    = true;
     size_t timeBegin = g_prevtime = monotonic_clock();
 
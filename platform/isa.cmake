@@ -68,6 +68,7 @@ set(detectVarsFilesMap
   HAVE_AVX512_F          x86_64_avx512_f.cpp
   HAVE_AVX512_BW         x86_64_avx512_bw.cpp
   HAVE_AVX512_VL         x86_64_avx512_vl.cpp
+  HAVE_AVX512_DQ         x86_64_avx512_dq.cpp
   HAVE_UMULH             x86_64_umulh.cpp
   HAVE_UMUL128           x86_64_umul128.cpp
   HAVE_X86_64_ASM        x86_64_asm.cpp
@@ -251,6 +252,12 @@ if(HAVE_SSE_2)
 	    if(HAVE_AVX512_VL)
 	      message(STATUS "  x86_64 AVX512-VL intrinsics available")
 	    endif()
+
+	    # Doubleword and Quadword
+	    feature_detect(HAVE_AVX512_DQ)
+	    if(HAVE_AVX512_DQ)
+	      message(STATUS "  x86_64 AVX512-DQ intrinsics available")
+	    endif()
 	  endif()
         endif()
       endif()
@@ -0,0 +1,10 @@
+########################################
+# Memory-mapped file availability detection
+########################################
+
+include(CheckSymbolExists)
+
+check_symbol_exists(mmap "sys/mman.h" HAVE_MMAP)
+if(HAVE_MMAP)
+  add_definitions(-DHAVE_MMAP)
+endif()
@@ -0,0 +1,10 @@
+#include <cstdio>
+#include "isa.h"
+
+uint64_t state[80];
+int main(void) {
+    __m512i FOO  = _mm512_set1_epi64(0x0405060708090a0b);
+    __m512i vals = _mm512_loadu_si512((const __m512i *)state);
+    vals = _mm512_mullo_epi64(vals, FOO);
+    _mm512_storeu_si512((__m512i *)(state+8), vals);
+}
@@ -82,6 +82,9 @@ static void calcBiasRange( const HashFn hash, const seed_t seed, std::vector<uin
     hashtype A, B;
     unsigned irep;
 
+    BitslicedHistogram<hashtype> hist( keybits );
+    auto rowbins = [&bins]( size_t iBit ) { return &bins[iBit * hashtype::bitlen]; };
+
     while ((irep = irepp++) < reps) {
         if (REPORT(PROGRESS, flags)) {
             progressdots(irep, 0, reps - 1, 18);
@@ -90,20 +93,20 @@ static void calcBiasRange( const HashFn hash, const seed_t seed, std::vector<uin
         ExtBlob K( &buf[0], &keys[keybytes * irep], keybytes );
         hash(K, keybytes, seed, &A);
 
-        uint32_t * cursor = &bins[0];
-
         for (unsigned iBit = 0; iBit < keybits; iBit++) {
-            prefetch(cursor);
-
             K.flipbit(iBit);
             hash(K, keybytes, seed, &B);
             K.flipbit(iBit);
 
             B ^= A;
 
-            cursor = HistogramHashBits(B, cursor);
+            hist.add(iBit, B);
         }
+
+        hist.nextRound(rowbins);
     }
+
+    hist.flush(rowbins);
 }
 
 //-----------------------------------------------------------------------------
@@ -54,14 +54,13 @@
 #include "Analyze.h"
 #include "Instantiate.h"
 #include "VCode.h"
+#include "ShardRun.h"
 
 #include "BadSeedsTest.h"
 
 #if defined(HAVE_THREADS)
-  #include <chrono>
   #include <atomic>
   #include <mutex>
-  #include <condition_variable>
 #endif
 
 //-----------------------------------------------------------------------------
@@ -76,15 +75,21 @@ static const int        maxtestlen   = testlens[numtestlens - 1];
 
 #if defined(HAVE_THREADS)
 // For keeping track of progress printouts across threads
-static std::atomic<unsigned>   seed_progress;
-static std::atomic<unsigned>   threads_remaining;
-static std::condition_variable threads_initialized;
-static std::mutex              print_mutex;
-static std::mutex              progress_mutex;
+static std::atomic<unsigned> seed_progress;
+static std::mutex            print_mutex;
+static std::mutex            state_mutex;
+typedef std::atomic<unsigned> a_uint;
 #else
 static unsigned seed_progress;
+typedef unsigned a_uint;
 #endif
 
+// Each 2^32 seed range is searched in blocks of 2^24 seeds, which threads
+// claim one at a time. This keeps every thread busy until the end of the
+// range, and lets the search be checkpointed at block boundaries.
+static constexpr unsigned seedblockbits = 24;
+static constexpr uint32_t numseedblocks = UINT32_C(1) << (32 - seedblockbits);
+
 template <typename hashtype>
 static void PrintZeroes( const HashFn hash, const seed_t hseed, const hashtype & zero, const uint8_t * keys) {
     hashtype v;
@@ -100,214 +105,447 @@ static void PrintZeroes( const HashFn hash, const seed_t hseed, const hashtype &
     printf("\n");
 }
 
-// Process part of a 2^32 range, split into g_NCPU threads
+// Quickly check whether any of the numtests hashes for a single seed are
+// identical, or are all zero bits, without sorting them. Duplicates are
+// found via a small open-addressed table of (index + 1) values, keyed on
+// some low hash bits. Weak hashes may cluster in the table, which only
+// costs probes; a hit is always confirmed with a full comparison.
+//
+// Almost every seed passes, so FindCollisionsIndices() is only needed to
+// produce the detailed report once a collision is known to exist.
+static constexpr size_t dupTableSize = 256;
+static_assert(numtests < dupTableSize / 2, "BadSeeds duplicate table is too small");
+
+template <typename hashtype>
+static bool HasDuplicateHashes( const std::vector<hashtype> & hashes ) {
+    uint8_t table[dupTableSize] = { 0 };
+
+    for (size_t i = 0; i < numtests; i++) {
+        uint32_t slot = (hashes[i].window(0, 24) * UINT32_C(0x9E3779B9)) >> 24;
+        while (table[slot] != 0) {
+            if (hashes[table[slot] - 1] == hashes[i]) {
+                return true;
+            }
+            slot = (slot + 1) & (dupTableSize - 1);
+        }
+        table[slot] = i + 1;
+    }
+
+    return false;
+}
+
+template <typename hashtype>
+static bool HasZeroHash( const std::vector<hashtype> & hashes, const hashtype & zero ) {
+    for (size_t i = 0; i < numtests; i++) {
+        if (hashes[i] == zero) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// The state of a search for new bad seeds. Range 0 is the first 2^32
+// seeds, and range 1 is the last 2^32 seeds. Only completed seed blocks
+// are reflected here, so that an interrupted search can be resumed from
+// g_resumeFile without losing or double-counting anything.
+struct BadSeedsState {
+    std::vector<bool>                     done[2];  // seed blocks fully searched
+    unsigned                              fails[2]; // bad seeds found so far
+    bool                                  result[2];
+    bool                                  newresult;
+    std::vector<std::pair<seed_t, bool>>  found;    // (seed, is broken) pairs
+
+    BadSeedsState( void ) : newresult( false ) {
+        for (unsigned r = 0; r < 2; r++) {
+            done[r].resize(numseedblocks, false);
+            fails[r]  = 0;
+            result[r] = true;
+        }
+    }
+};
+
+static const char checkpointhdr[] = "SMHasher3 BadSeeds checkpoint v1";
+static const char hexdigits[]     = "0123456789abcdef";
+static_assert((numseedblocks % 4) == 0, "BadSeeds checkpoint bitmap must be whole hex digits");
+static_assert((numseedblocks / 4) == 64, "BadSeeds checkpoint bitmap scanf width must match numseedblocks");
+
+// The state file is written to a temporary name and then renamed over the
+// old one, so that being killed mid-write leaves the last checkpoint intact.
+static void SaveBadSeedsState( const HashInfo * hinfo, const BadSeedsState & state ) {
+    const std::string tmpname = std::string(g_resumeFile) + ".tmp";
+    FILE *            f       = fopen(tmpname.c_str(), "w");
+
+    if (f == NULL) {
+        printf("Failed to open BadSeeds checkpoint file \"%s\" for writing\n", tmpname.c_str());
+        exit(1);
+    }
+
+    fprintf(f, "%s\n", checkpointhdr);
+    fprintf(f, "hash %s\n", hinfo->name);
+    fprintf(f, "endian %u\n", (unsigned)g_hashEndian);
+    for (unsigned r = 0; r < 2; r++) {
+        fprintf(f, "range %u %u %u ", r, state.fails[r], state.result[r] ? 1 : 0);
+        for (uint32_t i = 0; i < numseedblocks; i += 4) {
+            unsigned nibble = 0;
+            for (unsigned j = 0; j < 4; j++) {
+                nibble |= (state.done[r][i + j] ? 1 : 0) << j;
+            }
+            fputc(hexdigits[nibble], f);
+        }
+        fputc('\n', f);
+    }
+    fprintf(f, "newresult %u\n", state.newresult ? 1 : 0);
+    for (const auto & found: state.found) {
+        fprintf(f, "seed %016" PRIx64 " %u\n", found.first, found.second ? 1 : 0);
+    }
+
+    if ((fclose(f) != 0) || ((rename(tmpname.c_str(), g_resumeFile) != 0) &&
+            ((remove(g_resumeFile) != 0) || (rename(tmpname.c_str(), g_resumeFile) != 0)))) {
+        printf("Failed to write BadSeeds checkpoint file \"%s\"\n", g_resumeFile);
+        exit(1);
+    }
+}
+
+// Returns false if the state file does not exist yet, meaning the search
+// starts from scratch.
+static bool LoadBadSeedsState( const HashInfo * hinfo, BadSeedsState & state ) {
+    FILE * f = fopen(g_resumeFile, "r");
+
+    if (f == NULL) {
+        return false;
+    }
+
+    char     line[128];
+    char     name[256];
+    unsigned endian, newresult;
+    bool     valid = (fgets(line, sizeof(line), f) != NULL) &&
+            (strncmp(line, checkpointhdr, sizeof(checkpointhdr) - 1) == 0);
+
+    valid = valid && (fscanf(f, " hash %255s", name) == 1) && (strcmp(name, hinfo->name) == 0);
+    valid = valid && (fscanf(f, " endian %u", &endian) == 1) && (endian == (unsigned)g_hashEndian);
+    for (unsigned r = 0; valid && (r < 2); r++) {
+        char     bitmap[numseedblocks / 4 + 1];
+        unsigned range, fails, result;
+        valid = (fscanf(f, " range %u %u %u %64s", &range, &fails, &result, bitmap) == 4) &&
+                (range == r) && (strlen(bitmap) == (numseedblocks / 4));
+        for (uint32_t i = 0; valid && (i < numseedblocks); i += 4) {
+            const char * digit = strchr(hexdigits, bitmap[i / 4]);
+            valid = (digit != NULL);
+            for (unsigned j = 0; valid && (j < 4); j++) {
+                state.done[r][i + j] = (((digit - hexdigits) >> j) & 1) != 0;
+            }
+        }
+        state.fails[r]  = fails;
+        state.result[r] = (result != 0);
+    }
+    valid = valid && (fscanf(f, " newresult %u", &newresult) == 1);
+    state.newresult = (newresult != 0);
+    while (valid) {
+        uint64_t seed;
+        unsigned broken;
+        int      fields = fscanf(f, " seed %" SCNx64 " %u", &seed, &broken);
+        if (fields == EOF) {
+            break;
+        }
+        valid = (fields == 2);
+        state.found.emplace_back((seed_t)seed, broken != 0);
+    }
+    fclose(f);
+
+    if (!valid) {
+        printf("BadSeeds checkpoint file \"%s\" is invalid, or is not for this hash and endianness\n",
+                g_resumeFile);
+        exit(1);
+    }
+
+    return true;
+}
+
+// For --shard, the state is saved as a binary record instead. Merging the
+// states from all shards gives the state of one search over every block.
+static std::string PackBadSeedsState( const BadSeedsState & state ) {
+    std::string packed;
+
+    for (unsigned r = 0; r < 2; r++) {
+        for (uint32_t i = 0; i < numseedblocks; i += 8) {
+            uint8_t bits = 0;
+            for (unsigned j = 0; j < 8; j++) {
+                bits |= (state.done[r][i + j] ? 1 : 0) << j;
+            }
+            packed.push_back((char)bits);
+        }
+        packed.append((const char *)&state.fails[r], sizeof(state.fails[r]));
+        packed.push_back(state.result[r] ? 1 : 0);
+    }
+    packed.push_back(state.newresult ? 1 : 0);
+    for (const auto & found: state.found) {
+        const uint64_t seed = found.first;
+        packed.append((const char *)&seed, sizeof(seed));
+        packed.push_back(found.second ? 1 : 0);
+    }
+
+    return packed;
+}
+
+static bool MergeBadSeedsState( BadSeedsState & state, const std::string & packed ) {
+    const size_t fixedlen = 2 * (numseedblocks / 8 + sizeof(unsigned) + 1) + 1;
+    const size_t foundlen = sizeof(uint64_t) + 1;
+    const char * p        = packed.data();
+
+    if ((packed.size() < fixedlen) || (((packed.size() - fixedlen) % foundlen) != 0)) {
+        return false;
+    }
+
+    for (unsigned r = 0; r < 2; r++) {
+        for (uint32_t i = 0; i < numseedblocks; i += 8) {
+            const uint8_t bits = (uint8_t)*p++;
+            for (unsigned j = 0; j < 8; j++) {
+                if ((bits >> j) & 1) {
+                    state.done[r][i + j] = true;
+                }
+            }
+        }
+        unsigned fails;
+        memcpy(&fails, p, sizeof(fails)); p += sizeof(fails);
+        state.fails[r]  += fails;
+        state.result[r] &= (*p++ != 0);
+    }
+    state.newresult |= (*p++ != 0);
+    while (p < packed.data() + packed.size()) {
+        uint64_t seed;
+        memcpy(&seed, p, sizeof(seed)); p += sizeof(seed);
+        state.found.emplace_back((seed_t)seed, *p++ != 0);
+    }
+
+    return true;
+}
+
+// Search the given blocks of seeds in [hi + 0, hi + 0xffffffff] until none
+// remain. Each completed block is merged into the shared state (and saved,
+// if requested), so a search can be resumed from the last block boundary.
 template <typename hashtype>
-static void TestSeedRangeThread( const HashInfo * hinfo, const uint64_t hi, const uint32_t start,
-        const uint32_t endlow, bool & result, bool & newresult ) {
+static void TestSeedBlocksThread( const HashInfo * hinfo, const uint64_t hi, const unsigned range,
+        const std::vector<uint32_t> & blocks, BadSeedsState & state, a_uint & nextblock, a_uint & fails ) {
     const std::set<seed_t> &     seeds = hinfo->badseeds;
     const HashFn                 hash  = hinfo->hashFn(g_hashEndian);
-    const seed_t                 last  = hi | endlow;
     const hashtype               zero  = { 0 };
-    int                          fails = 0;
     std::vector<hashtype>        hashes( numtests );
     std::map<hashtype, uint32_t> collisions;
     std::vector<hidx_t>          collisionidxs;
     std::vector<hidx_t>          hashidxs;
 
-    const int      seedchars         = (last <= UINT64_C(0xffffffff)) ? 8 : 16;
+    const int      seedchars         = (hi == 0) ? 8 : 16;
     const uint64_t progress_nl_every = 64 / seedchars;
 
-    result = true;
-
-    {
-#if defined(HAVE_THREADS)
-        std::lock_guard<std::mutex> lock( print_mutex );
-#endif
-        printf("Testing [0x%0*" PRIx64 ", 0x%0*" PRIx64 "] ... \n", seedchars, hi | start, seedchars, last);
-        seed_progress = 0;
-    }
-
-#if defined(HAVE_THREADS)
-    {
-        std::lock_guard<std::mutex> lock( progress_mutex );
-        if (--threads_remaining == 0) {
-            threads_initialized.notify_one();
-        }
-    }
-#endif
-
     /* Premake all the test keys */
     VLA_ALLOC(uint8_t, keys, numtestbytes * maxtestlen);
     for (size_t i = 0; i < numtestbytes; i++) {
         memset(&keys[i * maxtestlen], testbytes[i], maxtestlen);
     }
 
-    seed_t seed = (hi | start);
-    do {
-        bool thisresult = true;
-
-        /*
-         * Print out progress using *one* printf() statement (for
-         * thread friendliness). Add newlines periodically to make
-         * output friendlier to humans, keeping track of printf()s
-         * across all threads.
-         */
-        if ((seed & UINT64_C(0x1ffffff)) == UINT64_C(0x1ffffff)) {
+    uint32_t blockidx;
+    while ((blockidx = nextblock++) < blocks.size()) {
+        const uint32_t block     = blocks[blockidx];
+        const seed_t   first     = hi | ((seed_t)block << seedblockbits);
+        const seed_t   last      = first | ((UINT64_C(1) << seedblockbits) - 1);
+        bool           result    = true;
+        bool           newresult = false;
+        bool           toomany   = false;
+        unsigned       blockfails = 0;
+        std::vector<std::pair<seed_t, bool>> found;
+
+        seed_t seed = first;
+        do {
+            bool thisresult = true;
+
+            /*
+             * Print out progress using *one* printf() statement (for
+             * thread friendliness). Add newlines periodically to make
+             * output friendlier to humans, keeping track of printf()s
+             * across all threads.
+             */
+            if ((seed & UINT64_C(0x1ffffff)) == UINT64_C(0x1ffffff)) {
 #if defined(HAVE_THREADS)
-            // Wish we had C++17's std::scoped_lock(), but this will do
-            std::lock(print_mutex, progress_mutex);
-            std::lock_guard<std::mutex> lock1(print_mutex, std::adopt_lock);
-            std::lock_guard<std::mutex> lock2(progress_mutex, std::adopt_lock);
+                std::lock_guard<std::mutex> lock( print_mutex );
 #endif
-            // print_mutex has been acquired, so read-test-modify should be safe here
-            unsigned   count  = ++seed_progress;
-            const char spacer = ((count % progress_nl_every) == 0) ? '\n' : ' ';
-            if (spacer == '\n') {
-                seed_progress = 0;
-            }
+                // print_mutex has been acquired, so read-test-modify should be safe here
+                unsigned   count  = ++seed_progress;
+                const char spacer = ((count % progress_nl_every) == 0) ? '\n' : ' ';
+                if (spacer == '\n') {
+                    seed_progress = 0;
+                }
 
-            printf("%0*" PRIx64 "%c", seedchars, seed, spacer);
-        }
+                printf("%0*" PRIx64 "%c", seedchars, seed, spacer);
+            }
 
-        /* Test the next seed against each test byte */
-        const seed_t hseed = hinfo->Seed(seed, HashInfo::SEED_FORCED, 1);
+            /* Test the next seed against each test byte */
+            const seed_t hseed = hinfo->Seed(seed, HashInfo::SEED_FORCED, 1);
 
-        memset((void *)&hashes[0], 0, numtests * sizeof(hashtype));
-        unsigned cnt = 0;
-        for (size_t i = 0; i < numtestbytes; i++) {
-            for (int len: testlens) {
-                hash(&keys[i * maxtestlen], len, hseed, &hashes[cnt++]);
+            memset((void *)&hashes[0], 0, numtests * sizeof(hashtype));
+            unsigned cnt = 0;
+            for (size_t i = 0; i < numtestbytes; i++) {
+                for (int len: testlens) {
+                    hash(&keys[i * maxtestlen], len, hseed, &hashes[cnt++]);
+                }
             }
-        }
 
-        /* Report if any collisions were found */
-        if (FindCollisionsIndices(hashes, collisions, numtests, numtests, collisionidxs, hashidxs) > 0) {
+            /*
+             * Report if any collisions were found. FindCollisionsIndices()
+             * sorts hashes[], so check for zero hashes before that.
+             */
+            const bool zerohash = HasZeroHash(hashes, zero);
+            if (HasDuplicateHashes(hashes) &&
+                    (FindCollisionsIndices(hashes, collisions, numtests, numtests, collisionidxs, hashidxs) > 0)) {
 #if defined(HAVE_THREADS)
-            std::lock_guard<std::mutex> lock( print_mutex );
+                std::lock_guard<std::mutex> lock( print_mutex );
 #endif
-            bool known_seed = (std::find(seeds.begin(), seeds.end(), seed) != seeds.end());
-            if (known_seed) {
-                printf("%sVerified bad seed 0x%0*" PRIx64 "\n", (seed_progress == 0) ? "" : "\n",  seedchars, seed);
-            } else {
-                printf("%sNew bad seed 0x%0*" PRIx64 "\n", (seed_progress == 0) ? "" : "\n", seedchars, seed);
-            }
-            seed_progress = 0;
+                bool known_seed = (std::find(seeds.begin(), seeds.end(), seed) != seeds.end());
+                if (known_seed) {
+                    printf("%sVerified bad seed 0x%0*" PRIx64 "\n", (seed_progress == 0) ? "" : "\n",  seedchars, seed);
+                } else {
+                    printf("%sNew bad seed 0x%0*" PRIx64 "\n", (seed_progress == 0) ? "" : "\n", seedchars, seed);
+                }
+                seed_progress = 0;
 
-            fails++;
-            if (fails > 300) {
-                fprintf(stderr, "Too many bad seeds, ending test\n");
-                if (g_NCPU > 1) {
-                    exit(1);
+                const unsigned nfails = ++fails;
+                blockfails++;
+                found.emplace_back(seed, false);
+                if (nfails > 300) {
+                    fprintf(stderr, "Too many bad seeds, ending test\n");
+                    if (g_NCPU > 1) {
+                        exit(1);
+                    }
+                    result  = false;
+                    toomany = true;
+                    break;
+                }
+                if (!known_seed && (nfails < 32)) { // don't print too many lines
+                    PrintCollisions(collisions, numtests, numtests, collisionidxs,
+                            [seed,seedchars,&keys](hidx_t idx){
+                                const unsigned lenidx  = idx % numtestbytes;
+                                const unsigned byteidx = idx / numtestbytes;
+                                printf("0x%0*" PRIx64 "\t%2d copies of 0x%02x", seedchars, seed,
+                                        testlens[lenidx], keys[byteidx * maxtestlen]);
+                            });
                 }
-                goto out;
-            }
-            if (!known_seed && (fails < 32)) { // don't print too many lines
-                PrintCollisions(collisions, numtests, numtests, collisionidxs,
-                        [seed,seedchars,&keys](hidx_t idx){
-                            const unsigned lenidx  = idx % numtestbytes;
-                            const unsigned byteidx = idx / numtestbytes;
-                            printf("0x%0*" PRIx64 "\t%2d copies of 0x%02x", seedchars, seed,
-                                    testlens[lenidx], keys[byteidx * maxtestlen]);
-                        });
-            }
 
-            thisresult = false;
-            if (!known_seed) {
-                newresult = true;
+                thisresult = false;
+                if (!known_seed) {
+                    newresult = true;
+                }
             }
-        }
-        hashidxs.clear();
+            hashidxs.clear();
 
-        /* Check for a broken seed */
-        if (hashes[0] == zero) {
-            bool known_seed = (std::find(seeds.begin(), seeds.end(), seed) != seeds.end());
+            /* Check for a broken seed */
+            if (zerohash) {
+                bool known_seed = (std::find(seeds.begin(), seeds.end(), seed) != seeds.end());
 #if defined(HAVE_THREADS)
-            std::lock_guard<std::mutex> lock( print_mutex );
+                std::lock_guard<std::mutex> lock( print_mutex );
 #endif
-            if (known_seed) {
-                printf("%sVerified broken seed 0x%0*" PRIx64 " => 0 hash value\n",
-                        (seed_progress == 0) ? "" : "\n", seedchars, seed);
-            } else {
-                printf("%sNew broken seed 0x%0*" PRIx64 " => 0 hash value\n",
-                        (seed_progress == 0) ? "" : "\n", seedchars, seed);
-            }
-            seed_progress = 0;
+                if (known_seed) {
+                    printf("%sVerified broken seed 0x%0*" PRIx64 " => 0 hash value\n",
+                            (seed_progress == 0) ? "" : "\n", seedchars, seed);
+                } else {
+                    printf("%sNew broken seed 0x%0*" PRIx64 " => 0 hash value\n",
+                            (seed_progress == 0) ? "" : "\n", seedchars, seed);
+                }
+                seed_progress = 0;
 
-            fails++;
-            if (!known_seed && (fails < 32)) { // don't print too many lines
-                PrintZeroes(hash, hseed, zero, &keys[0]);
-            }
+                const unsigned nfails = ++fails;
+                blockfails++;
+                found.emplace_back(seed, true);
+                if (!known_seed && (nfails < 32)) { // don't print too many lines
+                    PrintZeroes(hash, hseed, zero, &keys[0]);
+                }
 
-            thisresult = false;
-            if (!known_seed) {
-                newresult = true;
+                thisresult = false;
+                if (!known_seed) {
+                    newresult = true;
+                }
             }
-        }
 
-        result &= thisresult;
-    } while (seed++ != last);
+            result &= thisresult;
+        } while (seed++ != last);
 
-  out:
-    return;
+        {
+#if defined(HAVE_THREADS)
+            std::lock_guard<std::mutex> lock( state_mutex );
+#endif
+            state.result[range] &= result;
+            state.newresult     |= newresult;
+            // An abandoned block is not recorded as searched, so that
+            // resuming will search it again.
+            if (toomany) {
+                break;
+            }
+            state.done[range][block] = true;
+            state.fails[range]      += blockfails;
+            state.found.insert(state.found.end(), found.begin(), found.end());
+            if (g_resumeFile != NULL) {
+                SaveBadSeedsState(hinfo, state);
+            }
+        }
+    }
 }
 
-// Test a full 2**32 range [hi + 0, hi + 0xffffffff].
-// If no new bad seed is found, then newresult must be left unchanged.
+// Test a full 2**32 range [hi + 0, hi + 0xffffffff], skipping any seed
+// blocks which a resumed search has already completed.
 template <typename hashtype>
-static bool TestManySeeds( const HashInfo * hinfo, const uint64_t hi, bool & newresult ) {
-    bool result = true;
+static bool TestManySeeds( const HashInfo * hinfo, const uint64_t hi, const unsigned range, BadSeedsState & state ) {
+    const int             seedchars = (hi == 0) ? 8 : 16;
+    std::vector<uint32_t> blocks;
+    a_uint                nextblock( 0 );
+    a_uint                fails( state.fails[range] );
+
+    for (uint32_t i = 0; i < numseedblocks; i++) {
+        if (!state.done[range][i] && ShardOwns(range * numseedblocks + i)) {
+            blocks.push_back(i);
+        }
+    }
+
+    if (blocks.size() < numseedblocks) {
+        printf("%zu of %u seed blocks already tested%s\n", numseedblocks - blocks.size(),
+                numseedblocks, ShardPartial() ? " or left to other shards" : "");
+        for (const auto & found: state.found) {
+            if ((found.first & UINT64_C(0xffffffff00000000)) == hi) {
+                printf("Previously found %s seed 0x%0*" PRIx64 "%s\n", found.second ? "broken" : "bad",
+                        seedchars, found.first, found.second ? " => 0 hash value" : "");
+            }
+        }
+    }
 
     seed_progress = 0;
 
-    if (g_NCPU == 1) {
-        TestSeedRangeThread<hashtype>(hinfo, hi, 0x0, 0xffffffff, result, newresult);
+    printf("Testing [0x%0*" PRIx64 ", 0x%0*" PRIx64 "] ... \n", seedchars, hi, seedchars, hi | UINT64_C(0xffffffff));
+
+    if (blocks.empty()) {
+        // Nothing left to search
+    } else if (g_NCPU == 1) {
+        TestSeedBlocksThread<hashtype>(hinfo, hi, range, blocks, state, nextblock, fails);
         printf("\n");
     } else {
 #if defined(HAVE_THREADS)
-        // split into g_NCPU threads
         std::vector<std::thread> t(g_NCPU);
-        const uint64_t len = UINT64_C(0x100000000) / g_NCPU;
-        // Can't make VLAs in C++, so have to use vectors, but can't
-        // pass a ref of a bool in a vector to a thread... :-<
-        bool * results    = new bool[g_NCPU]();
-        bool * newresults = new bool[g_NCPU]();
 
         printf("%d threads starting...\n", g_NCPU);
-        {
-            std::unique_lock<std::mutex> lock( progress_mutex );
-
-            threads_remaining = g_NCPU;
-
-            for (unsigned i = 0; i < g_NCPU; i++) {
-                const uint32_t start = i * len;
-                const uint32_t end   = (i < (g_NCPU - 1)) ? start + (len - 1) : 0xffffffff;
-                t[i] = std::thread {
-                    TestSeedRangeThread<hashtype>, hinfo, hi, start, end,
-                    std::ref(results[i]), std::ref(newresults[i])
-                };
-            }
-
-            threads_initialized.wait(lock, []{ return !!(threads_remaining == 0); });
+        for (unsigned i = 0; i < g_NCPU; i++) {
+            t[i] = std::thread {
+                TestSeedBlocksThread<hashtype>, hinfo, hi, range, std::cref(blocks),
+                std::ref(state), std::ref(nextblock), std::ref(fails)
+            };
         }
 
-        //std::this_thread::sleep_for(std::chrono::seconds(1));
-
         for (unsigned i = 0; i < g_NCPU; i++) {
             t[i].join();
         }
 
         printf("All %d threads ended\n", g_NCPU);
-
-        for (unsigned i = 0; i < g_NCPU; i++) {
-            result    &= results[i];
-            newresult |= newresults[i];
-        }
-
-        delete [] results;
-        delete [] newresults;
 #endif
     }
 
+    const bool result = state.result[range];
+
     // Since this can be threaded, just use the test parameters for the
     // VCode input data.
     addVCodeInput(        hi); // hi
@@ -321,22 +559,59 @@ static bool TestManySeeds( const HashInfo * hinfo, const uint64_t hi, bool & new
 
 template <typename hashtype>
 static bool BadSeedsFind( const HashInfo * hinfo ) {
-    bool result    = true;
-    bool newresult = false;
+    BadSeedsState state;
+    bool          result = true;
+
+    if (ShardMerging()) {
+        const std::vector<std::string> records = ShardRecords("BadSeeds");
+        for (const std::string & record: records) {
+            if (!MergeBadSeedsState(state, record)) {
+                printf("Shard file BadSeeds results are corrupt\n");
+                exit(1);
+            }
+        }
+        // Merging never searches any seeds itself, so every seed block
+        // must have been searched by some shard. The only exception is a
+        // range which a shard stopped searching because it had already
+        // failed with too many bad seeds.
+        const unsigned ranges = hinfo->is32BitSeed() ? 1 : 2;
+        bool           allrun = (records.size() == g_mergeFiles.size());
+        for (unsigned r = 0; r < ranges; r++) {
+            for (uint32_t i = 0; i < numseedblocks; i++) {
+                allrun &= state.done[r][i] || !state.result[r];
+            }
+        }
+        if (!allrun) {
+            printf("Shard files are missing BadSeeds results for some seeds\n");
+            exit(1);
+        }
+        std::sort(state.found.begin(), state.found.end());
+        printf("Merged bad seed search results from %zu shards\n", records.size());
+    } else if (g_resumeFile != NULL) {
+        if (LoadBadSeedsState(hinfo, state)) {
+            printf("Resuming bad seed search from \"%s\"\n", g_resumeFile);
+        } else {
+            printf("Saving bad seed search progress to \"%s\"\n", g_resumeFile);
+        }
+    }
 
     printf("Testing the first 2**32 seeds ...\n");
-    result &= TestManySeeds<hashtype>(hinfo, UINT64_C(0x0), newresult);
+    result &= TestManySeeds<hashtype>(hinfo, UINT64_C(0x0), 0, state);
 
     if (!hinfo->is32BitSeed()) {
         printf("And the last 2**32 seeds ...\n");
-        result &= TestManySeeds<hashtype>(hinfo, UINT64_C(0xffffffff00000000), newresult);
+        result &= TestManySeeds<hashtype>(hinfo, UINT64_C(0xffffffff00000000), 1, state);
+    }
+
+    if (ShardPartial()) {
+        ShardSave("BadSeeds", PackBadSeedsState(state));
     }
 
     if (result) {
         printf("PASS\n");
     } else {
         printf("FAIL\n");
-        if (newresult) {
+        if (state.newresult) {
             printf("Consider adding any new bad seeds to this hash's list of badseeds in main.cpp\n");
         }
     }
@@ -136,44 +136,53 @@ static void BicTestBatch( HashFn hash, const seed_t seed, std::vector<uint32_t>
     hashtype  h1, h2;
     size_t    irep;
 
+    // The andcount histogram has one row per (keybit, out1) pair, holding the
+    // counts for out2 in (out1, hashbits). Row offsets are precomputed so the
+    // counters for out2 are at rowoffset[out1] + out2 within a keybit's block.
+    std::vector<size_t> rowoffset( hashbits );
+    for (size_t out1 = 0, off = 1; out1 < hashbits; off += hashbits - 1 - out1, out1++) {
+        rowoffset[out1] = off - (out1 + 1);
+    }
+
+    BitslicedHistogram<hashtype> pophist( keybits );
+    BitslicedHistogram<hashtype> andhist( keybits * hashbits );
+    auto poprow = [&popcount0]( size_t row ) { return &popcount0[row * hashbits]; };
+    auto androw = [&andcount0, &rowoffset]( size_t row ) {
+                return &andcount0[row / hashbits * hashbitpairs] + rowoffset[row % hashbits];
+            };
+
     while ((irep = irepp++) < reps) {
         progressdots(irep, 0, reps - 1, 12);
 
         ExtBlob key( &buf[0], &keys[keybytes * irep], keybytes );
         hash(key, keybytes, seed, &h1);
 
-        uint32_t * pop_cursor = &popcount0[0];
-
         for (size_t keybit = 0; keybit < keybits; keybit++) {
-            // The andcount array needs 1 element as a buffer due to how
-            // HistogramHashBits accesses memory prior to the cursor.
-            uint32_t * and_cursor = &andcount0[keybit * hashbitpairs + 1];
-
             key.flipbit(keybit);
             hash(key, keybytes, seed, &h2);
 
-            // The current arrangement of the andcount array doesn't allow
-            // for effective prefetching, unfortunately, but at least this
-            // helps a little bit.
-            prefetch(pop_cursor);
-
             key.flipbit(keybit);
 
             h2 = h1 ^ h2;
 
             // First count how often each output bit changes
-            pop_cursor = HistogramHashBits(h2, pop_cursor);
+            pophist.add(keybit, h2);
 
             // Then count how often each pair of output bits changed together
             for (size_t out1 = 0; out1 < hashbits - 1; out1++) {
                 if (h2.getbit(out1) == 0) {
-                    and_cursor += hashbits - 1 - out1;
                     continue;
                 }
-                and_cursor = HistogramHashBits(h2, and_cursor, out1 + 1);
+                andhist.add(keybit * hashbits + out1, h2, out1 + 1);
             }
         }
+
+        pophist.nextRound(poprow);
+        andhist.nextRound(androw);
     }
+
+    pophist.flush(poprow);
+    andhist.flush(androw);
 }
 
 template <typename hashtype>
@@ -198,8 +207,9 @@ static bool BicTestImpl( HashFn hash, const seed_t seed, const size_t keybytes,
     std::vector<std::vector<uint32_t>> popcounts( g_NCPU );
     std::vector<std::vector<uint32_t>> andcounts( g_NCPU );
     for (unsigned i = 0; i < g_NCPU; i++) {
-        // The andcount array needs 1 element as a buffer due to how
-        // HistogramHashBits accesses memory prior to the cursor.
+        // The andcount array needs 1 element as a buffer so that the
+        // BitslicedHistogram row for out1 == 0, which starts at the
+        // (nonexistent) out2 == 0 entry, still points into the array.
         popcounts[i].resize(keybits * hashbits);
         andcounts[i].resize(keybits * hashbitpairs + 1);
     }
@@ -52,63 +52,81 @@
 #include "Analyze.h"
 #include "Instantiate.h"
 #include "VCode.h"
+#include "ShardRun.h"
 
 #include "BitflipTest.h"
 
+#if defined(HAVE_THREADS)
+  #include <atomic>
+typedef std::atomic<unsigned> a_uint;
+#else
+typedef unsigned a_uint;
+#endif
+
 //-----------------------------------------------------------------------------
 // Simple bitflip test - for all 1-bit differentials, generate random keys,
 // apply the differential, and run full distribution/collision tests on the
 // hashes and their deltas.
+//
+// Each key bit is tested independently of the others, so several key bits
+// are tested at once, across up to g_NCPU threads. Each bit records its
+// VCodes and p-value counts privately, and those are merged in key bit
+// order once all bits are done, so the results don't depend on the number
+// of threads or their timing. This also lets the key bits be split across
+// processes with --shard, each saving its BitflipResults as-is, and then
+// reported on with --merge exactly as if they had been tested together.
+
+typedef struct {
+    vcode_chunk_t  vcode;
+    uint32_t       log2pcounts[COUNT_MAX_PVALUE + 2];
+    int            logp;
+    bool           result;
+} BitflipResult;
 
 template <typename hashtype>
-static bool BitflipTestImpl( const HashInfo * hinfo, unsigned keybits, const seed_t seed, flags_t flags ) {
-    const HashFn   hash     = hinfo->hashFn(g_hashEndian);
-    const unsigned keycount = 512 * 1024 * ((hinfo->bits <= 64) ? 3 : 4);
-    unsigned       keybytes = keybits / 8;
+static void BitflipHashes( const HashFn hash, const seed_t seed, const unsigned keybytes, const unsigned keybit,
+        const unsigned keycount, RandSeq rs, std::vector<uint8_t> & keys, std::vector<hashtype> & hashes ) {
+    rs.write(&keys[0], 0, keycount);
 
-    std::vector<hashtype> worsthashes;
-    int worstlogp   = -1;
-    int worstkeybit = -1;
-    int fails       =  0;
+    for (unsigned i = 0; i < keycount; i++) {
+        ExtBlob k( &keys[i * keybytes], keybytes );
 
-    std::vector<hashtype> hashes( keycount * 2 ), hashes_copy;
-    std::vector<uint8_t>  keys( keycount * keybytes );
+        hash(k, keybytes, seed, &hashes[2 * i]);
+        addVCodeInput(k, keybytes);
 
-    Rand r( 84574, keybytes );
+        k.flipbit(keybit);
 
-    bool result = true;
+        hash(k, keybytes, seed, &hashes[2 * i + 1]);
+        addVCodeInput(k, keybytes);
 
-    if (!REPORT(VERBOSE, flags)) {
-        printf("Testing %3d-byte keys, %d reps", keybytes, keycount);
+        // Restore the bit to its original value, so that keyprint()
+        // can get the original values in keys[].
+        k.flipbit(keybit);
     }
+}
 
-    for (unsigned keybit = 0; keybit < keybits; keybit++) {
+template <typename hashtype>
+static void BitflipTestBits( const HashFn hash, const seed_t seed, const unsigned keybits, const unsigned keycount,
+        const std::vector<RandSeq> & seqs, a_uint & ikeybit, a_uint & ndone, BitflipResult * results,
+        flags_t flags ) {
+    const unsigned keybytes = keybits / 8;
+
+    std::vector<hashtype> hashes( keycount * 2 );
+    std::vector<uint8_t>  keys( keycount * keybytes );
+    unsigned keybit;
+
+    while ((keybit = ikeybit++) < keybits) {
+        if (!ShardOwns(keybit)) {
+            continue;
+        }
         if (REPORT(VERBOSE, flags)) {
             printf("Testing bit %d / %d - %d keys\n", keybit, keybits, keycount);
         }
 
-        // Use a new sequence of keys for every key bit tested. Note that
-        // SEQ_DIST_2 is enough to ensure there are no collisions, because
-        // only 1 bit _position_ is flipped per set of keys, and (x ^ bitN)
-        // ^ (y ^ bitN) == x ^ y, which must have at least 2 set bits.
-        RandSeq rs = r.get_seq(SEQ_DIST_2, keybytes);
-        rs.write(&keys[0], 0, keycount);
-
-        for (unsigned i = 0; i < keycount; i++) {
-            ExtBlob k( &keys[i * keybytes], keybytes );
+        vcode_redirect          = &results[keybit].vcode;
+        g_log2pValueCountsLocal = results[keybit].log2pcounts;
 
-            hash(k, keybytes, seed, &hashes[2 * i]);
-            addVCodeInput(k, keybytes);
-
-            k.flipbit(keybit);
-
-            hash(k, keybytes, seed, &hashes[2 * i + 1]);
-            addVCodeInput(k, keybytes);
-
-            // Restore the bit to its original value, so that keyprint()
-            // below can get the original values in keys[].
-            k.flipbit(keybit);
-        }
+        BitflipHashes<hashtype>(hash, seed, keybytes, keybit, keycount, seqs[keybit], keys, hashes);
 
         auto keyprint = [&]( hidx_t i ) {
             ExtBlob k( &keys[(i >> 1) * keybytes], keybytes );
@@ -123,44 +141,155 @@ static bool BitflipTestImpl( const HashInfo * hinfo, unsigned keybits, const see
             if (i & 1) { k.flipbit(keybit); }
         };
 
-        // If VERBOSE reporting isn't enabled, then each test isn't being
-        // reported on, and so there might need to be a failure summary at
-        // the end of testing. If that's true, then keep a copy of the
-        // original list of hashes, since TestHashList() will modify it.
-        if (!REPORT(VERBOSE, flags)) {
-            hashes_copy = hashes;
-        }
-
         int  curlogp    = 0;
         bool thisresult = TestHashList(hashes).testDistribution(true).
                 reportFlags(flags).quiet(!REPORT(VERBOSE, flags)).
                 sumLogp(&curlogp).testDeltas(2).dumpFailKeys(keyprint);
 
+        addVCodeResult(thisresult);
+
+        results[keybit].logp   = curlogp;
+        results[keybit].result = thisresult;
+
         if (REPORT(VERBOSE, flags)) {
             printf("\n");
         } else {
-            progressdots(keybit, 0, keybits - 1, 20);
-            // Record worst result, but don't let a pass override a failure
-            if ((fails == 0) && !thisresult) {
-                worstlogp = -1;
-            }
-            if (((fails == 0) || !thisresult) && (worstlogp < curlogp)) {
-                worstlogp   = curlogp;
-                worstkeybit = keybit;
-                worsthashes = hashes_copy;
+            progressdots(ndone++, 0, keybits - 1, 20);
+        }
+    }
+
+    vcode_redirect          = NULL;
+    g_log2pValueCountsLocal = NULL;
+}
+
+template <typename hashtype>
+static bool BitflipTestImpl( const HashInfo * hinfo, unsigned keybits, const seed_t seed, flags_t flags ) {
+    const HashFn   hash     = hinfo->hashFn(g_hashEndian);
+    const unsigned keycount = 512 * 1024 * ((hinfo->bits <= 64) ? 3 : 4);
+    unsigned       keybytes = keybits / 8;
+    char           recordname[32];
+
+    // Per-bit VERBOSE output can't be recreated from saved results
+    if (ShardMerging()) {
+        flags &= ~FLAG_REPORT_VERBOSE;
+    }
+
+    // Use a new sequence of keys for every key bit tested. Note that
+    // SEQ_DIST_2 is enough to ensure there are no collisions, because
+    // only 1 bit _position_ is flipped per set of keys, and (x ^ bitN)
+    // ^ (y ^ bitN) == x ^ y, which must have at least 2 set bits. These
+    // are all made up front, so that they don't depend on which key bits
+    // are tested first.
+    Rand r( 84574, keybytes );
+    std::vector<RandSeq> seqs;
+    for (unsigned keybit = 0; keybit < keybits; keybit++) {
+        seqs.push_back(r.get_seq(SEQ_DIST_2, keybytes));
+    }
+
+    // Every thread needs its own keys and hashes, plus room for
+    // TestHashList() to work in, so --max-memory (or DEFAULT_PARALLEL_MEMORY
+    // without it) limits how many key bits are in flight at once. VERBOSE
+    // output is per-bit, so it stays serial.
+    const uint64_t bitmem   = (uint64_t)keycount * (keybytes + 2 * sizeof(hashtype) * 3);
+    unsigned       nthreads = std::min(g_NCPU, keybits);
+    const uint64_t maxmem   = (g_maxMemory != 0) ? g_maxMemory : DEFAULT_PARALLEL_MEMORY;
+    nthreads = std::max((uint64_t)1, std::min((uint64_t)nthreads, maxmem / bitmem));
+    if (REPORT(VERBOSE, flags)) {
+        nthreads = 1;
+    }
+
+    std::vector<BitflipResult> results( keybits );
+    a_uint ikeybit( 0 ), ndone( 0 );
+
+    if (!REPORT(VERBOSE, flags)) {
+        printf("Testing %3d-byte keys, %d reps", keybytes, keycount);
+    }
+
+    if (ShardMerging()) {
+        for (unsigned keybit = 0; keybit < keybits; keybit++) {
+            snprintf(recordname, sizeof(recordname), "Bitflip/%u/%u", keybytes, keybit);
+            std::vector<std::string> records = ShardRecords(recordname);
+            if ((records.size() != 1) || (records[0].size() != sizeof(BitflipResult))) {
+                printf("\nShard files are missing results for Bitflip key bit %u of %u\n", keybit, keybytes);
+                exit(1);
             }
-            if (!thisresult) {
-                fails++;
+            memcpy(&results[keybit], records[0].data(), sizeof(BitflipResult));
+            progressdots(keybit, 0, keybits - 1, 20);
+        }
+    } else if (nthreads == 1) {
+        BitflipTestBits<hashtype>(hash, seed, keybits, keycount, seqs, ikeybit, ndone, &results[0], flags);
+    } else {
+#if defined(HAVE_THREADS)
+        std::vector<std::thread> t( nthreads );
+        for (unsigned i = 0; i < nthreads; i++) {
+            t[i] = std::thread {
+                [&] {
+                    g_inParallel = true;
+                    BitflipTestBits<hashtype>(hash, seed, keybits, keycount, seqs, ikeybit, ndone, &results[0], flags);
+                }
+            };
+        }
+        for (unsigned i = 0; i < nthreads; i++) {
+            t[i].join();
+        }
+#endif
+    }
+
+    // The summary needs every key bit, so a shard just saves its own
+    if (ShardPartial()) {
+        unsigned tested = 0;
+        for (unsigned keybit = 0; keybit < keybits; keybit++) {
+            if (ShardOwns(keybit)) {
+                snprintf(recordname, sizeof(recordname), "Bitflip/%u/%u", keybytes, keybit);
+                ShardSave(recordname, &results[keybit], sizeof(BitflipResult));
+                tested++;
             }
         }
+        printf("%s%3d of %d key bits tested in this shard\n\n", REPORT(VERBOSE, flags) ? "" : " ",
+                tested, keybits);
+        return true;
+    }
 
-        addVCodeResult(thisresult);
+    int  worstlogp   = -1;
+    int  worstkeybit = -1;
+    int  fails       =  0;
+    bool result      = true;
+
+    for (unsigned keybit = 0; keybit < keybits; keybit++) {
+        const BitflipResult & res = results[keybit];
 
-        result &= thisresult;
+        mergeVCodeChunks(&res.vcode, 1);
+        mergeLog2PValueCounts(res.log2pcounts);
+
+        // Record worst result, but don't let a pass override a failure
+        if ((fails == 0) && !res.result) {
+            worstlogp = -1;
+        }
+        if (((fails == 0) || !res.result) && (worstlogp < res.logp)) {
+            worstlogp   = res.logp;
+            worstkeybit = keybit;
+        }
+        if (!res.result) {
+            fails++;
+        }
+
+        result &= res.result;
     }
 
+    // If VERBOSE reporting isn't enabled, then each test wasn't reported
+    // on, so print a summary of the worst one. Its hashes are regenerated
+    // into a scratch VCode chunk, since they were already counted.
     if (!REPORT(VERBOSE, flags)) {
         printf("%3d failed, worst is key bit %3d%s\n", fails, worstkeybit, result ? "" : "        !!!!!");
+
+        std::vector<hashtype> worsthashes( keycount * 2 );
+        std::vector<uint8_t>  keys( keycount * keybytes );
+        vcode_chunk_t         scratch = {};
+
+        vcode_redirect = &scratch;
+        BitflipHashes<hashtype>(hash, seed, keybytes, worstkeybit, keycount, seqs[worstkeybit], keys, worsthashes);
+        vcode_redirect = NULL;
+
         bool ignored = TestHashList(worsthashes).testDistribution(true).testDeltas(2);
         unused(ignored);
         printf("\n");
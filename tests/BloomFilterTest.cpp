@@ -0,0 +1,289 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+#include "Platform.h"
+#include "Timing.h"
+#include "Hashinfo.h"
+#include "TestGlobals.h"
+#include "Stats.h" // For GetStdNormalPValue, ScalePValue
+#include "Random.h"
+#include "Reporting.h"
+#include "Instantiate.h"
+#include "VCode.h"
+
+#include "BloomFilterTest.h"
+
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Bloom filter tests - build standard and cache-line-blocked Bloom filters
+// the way real-world filters typically do, deriving all k probe positions
+// from a single hash computation via Kirsch-Mitzenmacher double hashing,
+// and compare the measured false-positive rate against the theoretical
+// one. This catches hashes whose 32-bit slices are correlated with each
+// other, even if every individual bit avalanches well.
+//
+// Insert and query times are also reported, but they do not inform VCodes.
+
+static const uint32_t BLOCKBITS = 512;
+
+struct BloomConfig {
+    uint32_t  bitsperkey;
+    uint32_t  probes;
+    bool      blocked;
+};
+
+static const BloomConfig bloomconfigs[] = {
+    {  8,  6, false },
+    { 12,  8, false },
+    { 16, 11, false },
+    {  8,  6, true  },
+    { 12,  8, true  },
+    { 16, 11, true  },
+};
+
+// Split a hash into the two 32-bit values used for double hashing. Hashes
+// narrower than 64 bits have to derive the second value from the first,
+// and so they can never do better than their collision rate.
+template <typename hashtype>
+static FORCE_INLINE void BloomHashPair( const hashtype & h, uint32_t & h1, uint32_t & h2 ) {
+    if (sizeof(hashtype) >= 8) {
+        uint64_t v;
+        memcpy(&v, &h, 8);
+        h1 = (uint32_t)v;
+        h2 = (uint32_t)(v >> 32);
+    } else {
+        memcpy(&h1, &h, 4);
+        h2 = ROTL32(h1 * UINT32_C(0x9E3779B9), 16);
+    }
+}
+
+// Standard filters map each probe onto the whole bit array. Blocked
+// filters use h1 to select one 512-bit block, and then get each probe
+// position from the top bits of a multiplicative sequence seeded by h2.
+template <bool blocked, bool insert>
+static FORCE_INLINE bool BloomProbe( uint64_t * RESTRICT filter, const uint64_t size,
+        const uint32_t probes, const uint32_t h1, const uint32_t h2 ) {
+    if (blocked) {
+        uint64_t * block = &filter[(((uint64_t)h1 * size) >> 32) * (BLOCKBITS / 64)];
+        uint32_t   g     = h2;
+        for (uint32_t i = 0; i < probes; i++) {
+            g *= UINT32_C(0x9E3779B9);
+            const uint32_t pos = g >> 23;
+            if (insert) {
+                block[pos >> 6] |= UINT64_C(1) << (pos & 63);
+            } else if (!(block[pos >> 6] & (UINT64_C(1) << (pos & 63)))) {
+                return false;
+            }
+        }
+    } else {
+        uint32_t g = h1;
+        for (uint32_t i = 0; i < probes; i++) {
+            const uint64_t pos = ((uint64_t)g * size) >> 32;
+            if (insert) {
+                filter[pos >> 6] |= UINT64_C(1) << (pos & 63);
+            } else if (!(filter[pos >> 6] & (UINT64_C(1) << (pos & 63)))) {
+                return false;
+            }
+            g += h2;
+        }
+    }
+    return true;
+}
+
+// The classic (1 - (1 - 1/m)^kn)^k estimate is used for standard
+// filters. It is noticeably optimistic for filters as small as a single
+// block, so for blocked filters the exact distribution of the number of
+// set bits in a block is computed for each possible number of keys in it,
+// and then weighted by the Poisson distribution of keys per block.
+static double BloomExpectedFPR( const BloomConfig & cfg, const uint64_t size, const uint64_t nkeys,
+        const unsigned hashbits ) {
+    double fpr;
+
+    if (cfg.blocked) {
+        const double lambda = (double)nkeys / (double)size;
+        const double jmax   = lambda + 20.0 * sqrt(lambda) + 20.0;
+        std::vector<double> setbits( BLOCKBITS + 1, 0.0 ), next( BLOCKBITS + 1 );
+        setbits[0] = 1.0;
+        fpr        = 0.0;
+        for (uint64_t j = 0; j <= (uint64_t)jmax; j++) {
+            if (j > 0) {
+                for (uint32_t probe = 0; probe < cfg.probes; probe++) {
+                    std::fill(next.begin(), next.end(), 0.0);
+                    for (uint32_t x = 0; x <= BLOCKBITS; x++) {
+                        next[x] += setbits[x] * (double)x / (double)BLOCKBITS;
+                        if (x < BLOCKBITS) {
+                            next[x + 1] += setbits[x] * (double)(BLOCKBITS - x) / (double)BLOCKBITS;
+                        }
+                    }
+                    std::swap(setbits, next);
+                }
+            }
+            double pj   = exp((double)j * log(lambda) - lambda - lgamma((double)j + 1.0));
+            double fill = 0.0;
+            for (uint32_t x = 0; x <= BLOCKBITS; x++) {
+                fill += setbits[x] * pow((double)x / (double)BLOCKBITS, (double)cfg.probes);
+            }
+            fpr += pj * fill;
+        }
+    } else {
+        double fill = -expm1((double)(cfg.probes * nkeys) * log1p(-1.0 / (double)size));
+        fpr = pow(fill, (double)cfg.probes);
+    }
+
+    // A query key whose 32-bit hash matches any inserted key's hash is
+    // always a false positive for narrow hashes.
+    if (hashbits < 64) {
+        double coll = -expm1((double)nkeys * log1p(-exp2(-(double)hashbits)));
+        fpr = coll + (1.0 - coll) * fpr;
+    }
+
+    return fpr;
+}
+
+template <typename hashtype, bool blocked>
+static uint64_t BloomFilterRun( HashFn hash, const seed_t seed, const BloomConfig & cfg,
+        std::vector<uint64_t> & filter, const uint64_t size, const std::vector<uint8_t> & keys,
+        const unsigned keybytes, const uint64_t nkeys, double & ins_ns, double & qry_ns ) {
+    const uint8_t * key = &keys[0];
+    uint64_t        falsepositives = 0;
+    uint64_t        begin, end;
+    hashtype        h;
+    uint32_t        h1, h2;
+
+    std::fill(filter.begin(), filter.end(), 0);
+
+    begin = monotonic_clock();
+    for (uint64_t i = 0; i < nkeys; i++, key += keybytes) {
+        hash(key, keybytes, seed, &h);
+        BloomHashPair(h, h1, h2);
+        BloomProbe<blocked, true>(&filter[0], size, cfg.probes, h1, h2);
+    }
+    end    = monotonic_clock();
+    ins_ns = (double)(end - begin) / (double)nkeys;
+
+    begin = monotonic_clock();
+    for (uint64_t i = 0; i < nkeys; i++, key += keybytes) {
+        hash(key, keybytes, seed, &h);
+        BloomHashPair(h, h1, h2);
+        falsepositives += BloomProbe<blocked, false>(&filter[0], size, cfg.probes, h1, h2);
+    }
+    end    = monotonic_clock();
+    qry_ns = (double)(end - begin) / (double)nkeys;
+
+    return falsepositives;
+}
+
+// The first nkeys keys are inserted into each filter, and the second
+// nkeys keys are used as queries. Every key is distinct, so every
+// positive query result is a false positive.
+template <typename hashtype>
+static bool BloomFilterImpl( const HashInfo * hinfo, const seed_t seed, const char * keysetname,
+        const std::vector<uint8_t> & keys, const unsigned keybytes, const uint64_t nkeys, flags_t flags ) {
+    const HashFn hash     = hinfo->hashFn(g_hashEndian);
+    const unsigned hashbits = std::min(hinfo->bits, (uint32_t)64);
+    bool         result   = true;
+
+    printf("Keyset '%s' - %" PRIu64 " inserts, %" PRIu64 " queries\n", keysetname, nkeys, nkeys);
+
+    addVCodeInput(&keys[0], keys.size());
+
+    // Each keyset gets one p-value per filter configuration.
+    const unsigned nconfigs = sizeof(bloomconfigs) / sizeof(bloomconfigs[0]);
+
+    for (const BloomConfig & cfg: bloomconfigs) {
+        const uint64_t totalbits = nkeys * cfg.bitsperkey;
+        const uint64_t size      = cfg.blocked ? (totalbits + BLOCKBITS - 1) / BLOCKBITS : totalbits;
+        const uint64_t words     = cfg.blocked ? size * (BLOCKBITS / 64) : (size + 63) / 64;
+
+        std::vector<uint64_t> filter( words );
+        double   ins_ns, qry_ns;
+        uint64_t falsepositives;
+
+        if (cfg.blocked) {
+            falsepositives = BloomFilterRun<hashtype, true>(hash, seed, cfg, filter, size,
+                    keys, keybytes, nkeys, ins_ns, qry_ns);
+        } else {
+            falsepositives = BloomFilterRun<hashtype, false>(hash, seed, cfg, filter, size,
+                    keys, keybytes, nkeys, ins_ns, qry_ns);
+        }
+
+        const double expected = BloomExpectedFPR(cfg, size, nkeys, hashbits);
+        const double actual   = (double)falsepositives / (double)nkeys;
+        const double z        = ((double)falsepositives - expected * nkeys) /
+                sqrt((double)nkeys * expected * (1.0 - expected));
+        const double p_value  = ScalePValue(GetStdNormalPValue(z), nconfigs);
+
+        addVCodeResult(falsepositives);
+
+        if (!REPORT(QUIET, flags)) {
+            printf("%-8s %2d bits/key, %2d probes: %7.2f ns/insert, %7.2f ns/query"
+                    " - FPR expected %7.4f%%, actual %7.4f%% (%5.3fx) ",
+                    cfg.blocked ? "Blocked" : "Standard", cfg.bitsperkey, cfg.probes,
+                    ins_ns, qry_ns, 100.0 * expected, 100.0 * actual, actual / expected);
+        }
+        result &= ReportPValue(p_value, NULL, flags);
+    }
+
+    printf("\n");
+
+    recordTestResult(result, "BloomFilter", keysetname);
+
+    addVCodeResult(result);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype>
+bool BloomFilterTest( const HashInfo * hinfo, bool extra, flags_t flags ) {
+    const seed_t seed   = hinfo->Seed(g_seed);
+    uint64_t     nkeys  = extra ? (1 << 22) : (1 << 20);
+    bool         result = true;
+
+    printf("[[[ 'BloomFilter' Tests ]]]\n\n");
+
+    if (hinfo->isVerySlow()) {
+        nkeys /= 16;
+    }
+
+    // Sequential 64-bit integers
+    {
+        std::vector<uint8_t> keys( 2 * nkeys * 8 );
+        for (uint64_t i = 0; i < 2 * nkeys; i++) {
+            PUT_U64<false>(i, &keys[i * 8], 0);
+        }
+        result &= BloomFilterImpl<hashtype>(hinfo, seed, "Sequential", keys, 8, nkeys, flags);
+    }
+
+    // Distinct random 16-byte keys
+    {
+        Rand    r( 493217, 16 );
+        RandSeq rs = r.get_seq(SEQ_DIST_1, 16);
+        std::vector<uint8_t> keys( 2 * nkeys * 16 );
+        rs.write(&keys[0], 0, 2 * nkeys);
+        result &= BloomFilterImpl<hashtype>(hinfo, seed, "Random", keys, 16, nkeys, flags);
+    }
+
+    printf("%s\n", result ? "" : g_failstr);
+
+    return result;
+}
+
+INSTANTIATE(BloomFilterTest, HASHTYPELIST);
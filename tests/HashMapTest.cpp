@@ -113,7 +113,7 @@ static double HashMapSpeedTest( const HashInfo * hinfo, std::vector<std::string>
         int i = 0;
         begin = cycle_timer_start();
         for (it = words.begin(); it != words.end(); it++, i++) {
-            std::string line = *it;
+            const std::string & line = *it;
             hashmap[line] = 1;
             if (i % 100 == 0) {
                 hashmap.erase(line);
@@ -132,7 +132,7 @@ static double HashMapSpeedTest( const HashInfo * hinfo, std::vector<std::string>
         double t;
         begin = cycle_timer_start();
         for (it = words.begin(); it != words.end(); it++, i++) {
-            std::string line = *it;
+            const std::string & line = *it;
             if (hashmap[line]) {
                 found++;
             }
@@ -160,7 +160,7 @@ static double HashMapSpeedTest( const HashInfo * hinfo, std::vector<std::string>
         int i = 0;
         begin = cycle_timer_start();
         for (it = words.begin(); it != words.end(); it++, i++) {
-            std::string line = *it;
+            const std::string & line = *it;
             phashmap[line] = 1;
             if (i % 100 == 0) {
                 phashmap.erase(line);
@@ -179,7 +179,7 @@ static double HashMapSpeedTest( const HashInfo * hinfo, std::vector<std::string>
         double t;
         begin = cycle_timer_start();
         for (it = words.begin(); it != words.end(); it++, i++) {
-            std::string line = *it;
+            const std::string & line = *it;
             if (phashmap[line]) {
                 found++;
             }
@@ -198,13 +198,150 @@ static double HashMapSpeedTest( const HashInfo * hinfo, std::vector<std::string>
     return mean;
 }
 
+//-----------------------------------------------------------------------------
+// Hash-flooding test - measure how badly each hashmap degrades when fed
+// keys which all land in the same bucket, versus the same number of
+// random keys.
+//
+// The flooding keys are found by brute-force search against each map's
+// own bucket selection function (hash % bucket_count for
+// std::unordered_map, and the low bits of the mixed hash, after removing
+// the control bits, for phmap). Maps are sized up front so that they
+// never rehash, so the bucket selection never changes during the test.
+// For seedless hashes this is a realistic attack; for seeded hashes this
+// represents the worst-case exposure if the seed were to leak.
+
+static const unsigned FLOOD_KEYS    = 2000;
+static const unsigned FLOOD_KEYLEN  = 16;
+static const uint64_t FLOOD_MAXTRYS = UINT64_C(1) << 25;
+
+template <typename maptype>
+static void HashMapFloodTime( maptype & map, const std::vector<std::string> & keys,
+        const int trials, double & t_insert, double & t_query ) {
+    std::vector<double> times;
+    volatile int64_t    begin, end;
+
+    begin = cycle_timer_start();
+    for (const std::string & key: keys) {
+        map[key] = 1;
+    }
+    end      = cycle_timer_end();
+    t_insert = (double)(end - begin) / (double)keys.size();
+
+    times.reserve(trials);
+    for (int itrial = 0; itrial < trials; itrial++) {
+        int found = 0;
+        begin = cycle_timer_start();
+        for (const std::string & key: keys) {
+            if (map.find(key) != map.end()) {
+                found++;
+            }
+        }
+        end = cycle_timer_end();
+        double t = (double)(end - begin) / (double)keys.size();
+        if ((found > 0) && (t > 0)) { times.push_back(t); }
+    }
+    map.clear();
+
+    FilterOutliers(times);
+    t_query = CalcMean(times);
+}
+
+template <typename maptype>
+static void HashMapFloodReport( const char * name, std::function<maptype ()> mkmap,
+        const std::vector<std::string> & randkeys, const std::vector<std::string> & floodkeys,
+        const int trials ) {
+    double   rand_ins, rand_qry, flood_ins, flood_qry;
+    maptype  randmap  = mkmap();
+    maptype  floodmap = mkmap();
+
+    HashMapFloodTime(randmap , randkeys , trials, rand_ins , rand_qry );
+    HashMapFloodTime(floodmap, floodkeys, trials, flood_ins, flood_qry);
+
+    printf("\nFlood %s inserts: %10.3f vs %8.3f cycles/op (%7.1fx slowdown)",
+            name, flood_ins, rand_ins, flood_ins / rand_ins);
+    printf("\nFlood %s queries: %10.3f vs %8.3f cycles/op (%7.1fx slowdown)",
+            name, flood_qry, rand_qry, flood_qry / rand_qry);
+}
+
+static void HashMapFloodTest( const HashInfo * hinfo, const int trials, const flags_t flags ) {
+    Rand r( 217098 );
+
+    const HashFn   hash   = hinfo->hashFn(g_hashEndian);
+    const seed_t   seed   = hinfo->Seed(g_seed ^ r.rand_u64());
+    const unsigned nkeys  = FLOOD_KEYS;
+    auto           hasher = [=]( const std::string & key ) {
+                // 256 needed for hasshe2, but only size_t used
+                char out[256] = { 0 };
+                hash(key.c_str(), key.length(), seed, &out);
+                return *(size_t *)out;
+            };
+
+    std::function<std_hashmap ()> mkstd = [&]() {
+                std_hashmap m( nkeys, hasher );
+                return m;
+            };
+    std::function<fast_hashmap ()> mkfast = [&]() {
+                fast_hashmap m( 0, hasher );
+                m.reserve(nkeys);
+                return m;
+            };
+
+    // Neither map will rehash after being constructed by the
+    // functions above, so their bucket counts are fixed.
+    const size_t std_buckets  = mkstd().bucket_count();
+    const size_t fast_mask    = mkfast().bucket_count();
+
+    std::vector<std::string> randkeys, stdkeys, fastkeys;
+    std::string key( FLOOD_KEYLEN, '\0' );
+    uint64_t    ctr = r.rand_u64(), trys = 0;
+    const uint64_t ctr2 = r.rand_u64();
+
+    memcpy(&key[8], &ctr2, 8);
+    while (((stdkeys.size() < nkeys) || (fastkeys.size() < nkeys)) && (trys < FLOOD_MAXTRYS)) {
+        memcpy(&key[0], &ctr, 8);
+        ctr++; trys++;
+
+        const size_t h = hasher(key);
+        if (randkeys.size() < nkeys) {
+            randkeys.push_back(key);
+        }
+        if ((stdkeys.size() < nkeys) && ((h % std_buckets) == 0)) {
+            stdkeys.push_back(key);
+        }
+        if ((fastkeys.size() < nkeys) &&
+                ((((phmap::phmap_mix<sizeof(size_t)>()(h)) >> 7) & fast_mask) == 0)) {
+            fastkeys.push_back(key);
+        }
+    }
+
+    printf("\n\nHash-flooding with %u same-bucket keys vs. %u random keys (%s)", nkeys, nkeys,
+            (hinfo->hash_flags & FLAG_HASH_NO_SEED) ? "hash is seedless" : "assuming a leaked seed");
+    if (REPORT(VERBOSE, flags)) {
+        printf("\nSearched %" PRIu64 " keys, found %zu std and %zu fast flooding keys",
+                trys, stdkeys.size(), fastkeys.size());
+    }
+
+    if (stdkeys.size() < nkeys) {
+        printf("\nFlood std  skipped; only %zu of %u keys found", stdkeys.size(), nkeys);
+    } else {
+        HashMapFloodReport<std_hashmap>("std ", mkstd, randkeys, stdkeys, trials);
+    }
+    if (fastkeys.size() < nkeys) {
+        printf("\nFlood fast skipped; only %zu of %u keys found", fastkeys.size(), nkeys);
+    } else {
+        HashMapFloodReport<fast_hashmap>("fast", mkfast, randkeys, fastkeys, trials);
+    }
+}
+
 //-----------------------------------------------------------------------------
 
-static bool HashMapImpl( const HashInfo * hinfo, std::vector<std::string> words,
+static bool HashMapImpl( const HashInfo * hinfo, const std::vector<std::string> & words,
         const int trials, const flags_t flags ) {
 
     try {
         HashMapSpeedTest(hinfo, words, trials, flags);
+        HashMapFloodTest(hinfo, trials, flags);
     } catch (...) {
         printf(" aborted !!!!\n");
     }
@@ -229,7 +366,7 @@ bool HashMapTest( const HashInfo * hinfo, bool extra, flags_t flags ) {
         return result;
     }
 
-    std::vector<std::string> words = GetWordlist(CASE_ALL, REPORT(VERBOSE, flags));
+    std::vector<std::string> words = GetWordlist(CASE_ALL, REPORT(VERBOSE, flags)).strings();
     if (!words.size()) {
         printf("WARNING: Hashmap initialization failed! Skipping Hashmap test.\n");
         return result;
@@ -0,0 +1,223 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+#include "Platform.h"
+#include "Timing.h"
+#include "Hashinfo.h"
+#include "TestGlobals.h"
+#include "Stats.h" // For GetBoundedPoissonPValue, ScalePValue
+#include "Blobsort.h"
+#include "Reporting.h"
+#include "Instantiate.h"
+#include "VCode.h"
+
+#include "PartitionTest.h"
+
+//-----------------------------------------------------------------------------
+// Partition tests - radix-partition many keys by the top bits of their
+// hashes, as the partitioning phase of a hash join does, and measure the
+// partitioning throughput and the size of the largest partition relative
+// to the mean. Partitioning is split across threads in the usual way:
+// each thread hashes and histograms its own slice of the keys, and then
+// after the per-thread output positions of each partition are computed,
+// each thread scatters its slice using the same code as radixsort().
+//
+// Throughput is reported in GB/s of keys partitioned, including hashing
+// time. This is functionally a speed test, but partition sizes do inform
+// VCodes.
+
+static const uint32_t partitionbits[] = { 4, 6, 8, 10, 12, 14 };
+
+// Partitions are selected by the top bits of the first 64 bits of the
+// hash, or of the whole hash if it is narrower than that.
+template <typename hashtype>
+static FORCE_INLINE uint64_t PartitionHashValue( const hashtype & h ) {
+    if (sizeof(hashtype) >= 8) {
+        uint64_t v;
+        memcpy(&v, &h, 8);
+        return v;
+    } else {
+        uint32_t v;
+        memcpy(&v, &h, 4);
+        return (uint64_t)v << 32;
+    }
+}
+
+template <typename hashtype, typename keytype>
+static void PartitionHistogram( HashFn hash, const seed_t seed, const keytype * keys, uint16_t * parts,
+        const size_t count, const uint32_t bits, uint32_t * freqs ) {
+    hashtype h;
+
+    for (size_t i = 0; i < count; i++) {
+        hash(&keys[i], sizeof(keytype), seed, &h);
+        const uint32_t part = (uint32_t)(PartitionHashValue(h) >> (64 - bits));
+        parts[i] = part;
+        freqs[part]++;
+    }
+}
+
+template <typename keytype>
+static void PartitionScatter( keytype * keys, const keytype * out, const uint16_t * parts,
+        const size_t count, keytype ** queue_ptrs ) {
+    radixscatter<false>(keys, out, queue_ptrs, (const hidx_t *)NULL, (hidx_t *)NULL, count,
+            [&]( size_t i ) { return parts[i]; });
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype, typename keytype>
+static bool PartitionImpl( const HashInfo * hinfo, const seed_t seed, const char * keysetname,
+        std::vector<keytype> & keys, flags_t flags ) {
+    const HashFn   hash     = hinfo->hashFn(g_hashEndian);
+    const size_t   count    = keys.size();
+    const unsigned nthreads = g_NCPU;
+    bool           result   = true;
+
+    std::vector<keytype>  out( count );
+    std::vector<uint16_t> parts( count );
+    std::vector<size_t>   slices( nthreads + 1 );
+
+    for (unsigned t = 0; t <= nthreads; t++) {
+        slices[t] = count * t / nthreads;
+    }
+
+    printf("Keyset '%s' - %zu %zu-byte keys, %d thread%s\n", keysetname, count,
+            sizeof(keytype), nthreads, (nthreads == 1) ? "" : "s");
+
+    addVCodeInput(&keys[0], count * sizeof(keytype));
+
+    for (uint32_t bits: partitionbits) {
+        const uint32_t nparts = 1 << bits;
+        uint64_t       begin, end;
+
+        std::vector<std::vector<uint32_t>>  freqs( nthreads, std::vector<uint32_t>(nparts, 0));
+        std::vector<std::vector<keytype *>> queue_ptrs( nthreads, std::vector<keytype *>(nparts));
+        std::vector<uint32_t> sizes( nparts, 0 );
+
+        begin = monotonic_clock();
+
+        if (nthreads == 1) {
+            PartitionHistogram<hashtype>(hash, seed, &keys[0], &parts[0], count, bits, &freqs[0][0]);
+        } else {
+#if defined(HAVE_THREADS)
+            std::vector<std::thread> t( nthreads );
+            for (unsigned i = 0; i < nthreads; i++) {
+                t[i] = std::thread {
+                    PartitionHistogram<hashtype, keytype>, hash, seed, &keys[slices[i]], &parts[slices[i]],
+                    slices[i + 1] - slices[i], bits, &freqs[i][0]
+                };
+            }
+            for (unsigned i = 0; i < nthreads; i++) {
+                t[i].join();
+            }
+#endif
+        }
+
+        // Each thread's part of each partition follows the previous
+        // thread's part, so the result is the same as a serial partition.
+        keytype * next = &out[0];
+        for (uint32_t p = 0; p < nparts; p++) {
+            for (unsigned i = 0; i < nthreads; i++) {
+                queue_ptrs[i][p] = next;
+                next            += freqs[i][p];
+                sizes[p]        += freqs[i][p];
+            }
+        }
+
+        if (nthreads == 1) {
+            PartitionScatter(&keys[0], &out[0], &parts[0], count, &queue_ptrs[0][0]);
+        } else {
+#if defined(HAVE_THREADS)
+            std::vector<std::thread> t( nthreads );
+            for (unsigned i = 0; i < nthreads; i++) {
+                t[i] = std::thread {
+                    PartitionScatter<keytype>, &keys[slices[i]], &out[0], &parts[slices[i]],
+                    slices[i + 1] - slices[i], &queue_ptrs[i][0]
+                };
+            }
+            for (unsigned i = 0; i < nthreads; i++) {
+                t[i].join();
+            }
+#endif
+        }
+
+        end = monotonic_clock();
+
+        addVCodeResult(&sizes[0], nparts * sizeof(sizes[0]));
+
+        const double   expected = (double)count / (double)nparts;
+        const uint32_t maxsize  = *std::max_element(sizes.begin(), sizes.end());
+        const double   p_value  = ScalePValue(GetBoundedPoissonPValue(expected, maxsize), nparts);
+
+        if (!REPORT(QUIET, flags)) {
+            printf("%5d partitions: %7.3f GB/s - max/mean partition size %7.4f ", nparts,
+                    (double)(count * sizeof(keytype)) / (double)(end - begin), (double)maxsize / expected);
+        }
+        result &= ReportPValue(p_value, NULL, flags);
+    }
+
+    printf("\n");
+
+    recordTestResult(result, "Partition", keysetname);
+
+    addVCodeResult(result);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype>
+bool PartitionTest( const HashInfo * hinfo, bool extra, flags_t flags ) {
+    const seed_t seed     = hinfo->Seed(g_seed);
+    size_t       keycount = extra ? (1 << 25) : (1 << 24);
+    bool         result   = true;
+
+    printf("[[[ 'Partition' Tests ]]]\n\n");
+
+    if (hinfo->isVerySlow()) {
+        keycount /= 16;
+    }
+
+    // Sequential 64-bit integers, as with surrogate join keys
+    {
+        std::vector<Blob<64>> keys( keycount );
+        for (size_t i = 0; i < keycount; i++) {
+            keys[i] = Blob<64>( (uint64_t)i );
+        }
+        result &= PartitionImpl<hashtype>(hinfo, seed, "Sequential", keys, flags);
+    }
+
+    // Sequential 64-bit integers with a fixed 64-bit prefix, as with
+    // composite (tenant, id) join keys
+    {
+        std::vector<Blob<128>> keys( keycount );
+        for (size_t i = 0; i < keycount; i++) {
+            uint8_t * k = (uint8_t *)&keys[i];
+            PUT_U64<false>(UINT64_C(0x0123456789ABCDEF), k, 0);
+            PUT_U64<false>(i, k, 8);
+        }
+        result &= PartitionImpl<hashtype>(hinfo, seed, "Composite", keys, flags);
+    }
+
+    printf("%s\n", result ? "" : g_failstr);
+
+    return result;
+}
+
+INSTANTIATE(PartitionTest, HASHTYPELIST);
@@ -87,6 +87,21 @@ static void SeedBicTestBatch( const HashInfo * hinfo, std::vector<uint32_t> & po
     size_t   iseed;
     uint64_t baseseed = 0;
 
+    // The andcount histogram has one row per (seedbit, out1) pair, holding the
+    // counts for out2 in (out1, hashbits). Row offsets are precomputed so the
+    // counters for out2 are at rowoffset[out1] + out2 within a seedbit's block.
+    std::vector<size_t> rowoffset( hashbits );
+    for (size_t out1 = 0, off = 1; out1 < hashbits; off += hashbits - 1 - out1, out1++) {
+        rowoffset[out1] = off - (out1 + 1);
+    }
+
+    BitslicedHistogram<hashtype> pophist( seedbits );
+    BitslicedHistogram<hashtype> andhist( seedbits * hashbits );
+    auto poprow = [&popcount0]( size_t row ) { return &popcount0[row * hashbits]; };
+    auto androw = [&andcount0, &rowoffset]( size_t row ) {
+                return &andcount0[row / hashbits * hashbitpairs] + rowoffset[row % hashbits];
+            };
+
     while ((irep = irepp++) < reps) {
         progressdots(irep, 0, reps - 1, 12);
 
@@ -98,31 +113,30 @@ static void SeedBicTestBatch( const HashInfo * hinfo, std::vector<uint32_t> & po
         seed_t hseed = hinfo->Seed(iseed, HashInfo::SEED_FORCED, 1);
         hash(key, keybytes, hseed, &h1);
 
-        uint32_t * pop_cursor = &popcount0[0];
-
         for (size_t seedbit = 0; seedbit < seedbits; seedbit++) {
-            // The andcount array needs 1 element as a buffer due to how
-            // HistogramHashBits accesses memory prior to the cursor.
-            uint32_t * and_cursor = &andcount0[seedbit * hashbitpairs + 1];
-
             hseed = hinfo->Seed(iseed ^ UINT64_C(1) << seedbit, HashInfo::SEED_FORCED, 1);
             hash(key, keybytes, hseed, &h2);
 
             h2 = h1 ^ h2;
 
             // First count how often each output bit changes
-            pop_cursor = HistogramHashBits(h2, pop_cursor);
+            pophist.add(seedbit, h2);
 
             // Then count how often each pair of output bits changed together
             for (size_t out1 = 0; out1 < hashbits - 1; out1++) {
                 if (h2.getbit(out1) == 0) {
-                    and_cursor += hashbits - 1 - out1;
                     continue;
                 }
-                and_cursor = HistogramHashBits(h2, and_cursor, out1 + 1);
+                andhist.add(seedbit * hashbits + out1, h2, out1 + 1);
             }
         }
+
+        pophist.nextRound(poprow);
+        andhist.nextRound(androw);
     }
+
+    pophist.flush(poprow);
+    andhist.flush(androw);
 }
 
 template <typename hashtype>
@@ -154,8 +168,9 @@ static bool SeedBicTestImpl( const HashInfo * hinfo, const size_t keybytes, cons
     std::vector<std::vector<uint32_t>> popcounts( g_NCPU );
     std::vector<std::vector<uint32_t>> andcounts( g_NCPU );
     for (unsigned i = 0; i < g_NCPU; i++) {
-        // The andcount array needs 1 element as a buffer due to how
-        // HistogramHashBits accesses memory prior to the cursor.
+        // The andcount array needs 1 element as a buffer so that the
+        // BitslicedHistogram row for out1 == 0, which starts at the
+        // (nonexistent) out2 == 0 entry, still points into the array.
         popcounts[i].resize(seedbits * hashbits);
         andcounts[i].resize(seedbits * hashbitpairs + 1);
     }
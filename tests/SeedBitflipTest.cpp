@@ -55,73 +55,84 @@
 
 #include "SeedBitflipTest.h"
 
+#if defined(HAVE_THREADS)
+  #include <atomic>
+typedef std::atomic<unsigned> a_uint;
+#else
+typedef unsigned a_uint;
+#endif
+
 //-----------------------------------------------------------------------------
 // Simple bitflip test - for all 1-bit differentials, generate random keys
 // and seeds, apply the differential to the seed, and run full
 // distribution/collision tests on the hashes and their deltas.
+//
+// As in BitflipTest.cpp, seed bits are tested concurrently, and their
+// VCodes and p-value counts are merged in seed bit order afterwards.
 
-template <typename hashtype, bool bigseed>
-static bool SeedBitflipTestImpl( const HashInfo * hinfo, unsigned keybits, flags_t flags ) {
-    const HashFn   hash      = hinfo->hashFn(g_hashEndian);
-    unsigned       seedbytes = bigseed ? 8 : 4;
-    unsigned       seedbits  = seedbytes * 8;
-    unsigned       keybytes  = keybits / 8;
-    const unsigned keycount  = 512 * 1024 * 3;
+typedef struct {
+    vcode_chunk_t  vcode;
+    uint32_t       log2pcounts[COUNT_MAX_PVALUE + 2];
+    int            logp;
+    bool           result;
+} SeedBitflipResult;
+
+template <typename hashtype>
+static void SeedBitflipHashes( const HashInfo * hinfo, const unsigned keybytes, const unsigned seedbytes,
+        const unsigned seedbit, const unsigned keycount, RandSeq rsK, RandSeq rsS, std::vector<uint8_t> & keys,
+        std::vector<uint8_t> & seeds, std::vector<hashtype> & hashes ) {
+    const HashFn hash = hinfo->hashFn(g_hashEndian);
 
-    std::vector<hashtype> worsthashes;
-    int worstlogp    = -1;
-    int worstseedbit = -1;
-    int fails        =  0;
+    rsK.write(&keys[0], 0, keycount);
+    addVCodeInput(&keys[0], keycount * keybytes);
 
-    std::vector<hashtype> hashes( keycount * 2 ), hashes_copy;
-    std::vector<uint8_t>  keys( keycount * keybytes );
-    std::vector<uint8_t>  seeds( keycount * seedbytes );
+    rsS.write(&seeds[0], 0, keycount);
 
-    Rand r( 18734, keybytes );
+    const uint8_t * keyptr  = &keys[0];
+    const uint8_t * seedptr = &seeds[0];
+    seed_t curseed = 0, hseed1, hseed2;
+    for (unsigned i = 0; i < keycount; i++) {
+        memcpy(&curseed, seedptr, seedbytes);
+        curseed = hinfo->getFixedSeed(curseed);
 
-    bool result = true;
+        addVCodeInput(curseed);
+        hseed1 = hinfo->Seed(curseed, HashInfo::SEED_FORCED);
+        hash(keyptr, keybytes, hseed1, &hashes[2 * i]);
 
-    if (!REPORT(VERBOSE, flags)) {
-        printf("Testing %3d-byte keys, %2d-bit seeds, %d reps", keybytes, seedbits, keycount);
+        curseed ^= (UINT64_C(1) << seedbit);
+
+        addVCodeInput(curseed);
+        hseed2 = hinfo->Seed(curseed, HashInfo::SEED_FORCED);
+        hash(keyptr, keybytes, hseed2, &hashes[2 * i + 1]);
+
+        keyptr  += keybytes;
+        seedptr += seedbytes;
     }
+}
 
-    for (unsigned seedbit = 0; seedbit < seedbits; seedbit++) {
+template <typename hashtype>
+static void SeedBitflipTestBits( const HashInfo * hinfo, const unsigned keybits, const unsigned seedbits,
+        const unsigned keycount, const std::vector<RandSeq> & seqs, a_uint & iseedbit, a_uint & ndone,
+        SeedBitflipResult * results, flags_t flags ) {
+    const HashFn   hash      = hinfo->hashFn(g_hashEndian);
+    const unsigned keybytes  = keybits / 8;
+    const unsigned seedbytes = seedbits / 8;
+
+    std::vector<hashtype> hashes( keycount * 2 );
+    std::vector<uint8_t>  keys( keycount * keybytes );
+    std::vector<uint8_t>  seeds( keycount * seedbytes );
+    unsigned seedbit;
+
+    while ((seedbit = iseedbit++) < seedbits) {
         if (REPORT(VERBOSE, flags)) {
             printf("Testing seed bit %d / %d - %3d-byte keys - %d keys\n", seedbit, seedbits, keybytes, keycount);
         }
 
-        // Use a new sequence of keys for every seed bit tested
-        RandSeq rsK = r.get_seq(SEQ_DIST_1, keybytes);
-        rsK.write(&keys[0], 0, keycount);
-        addVCodeInput(&keys[0], keycount * keybytes);
-
-        // Use a new sequence of seeds for every seed bit tested also. Note
-        // that SEQ_DIST_2 is enough to ensure there are no collisions,
-        // because only 1 bit _position_ is flipped per set of seeds, and
-        // (x ^ N) ^ (y ^ N) == x ^ y, which must have at least 2 set bits.
-        RandSeq rsS = r.get_seq(SEQ_DIST_2, seedbytes);
-        rsS.write(&seeds[0], 0, keycount);
-
-        const uint8_t * keyptr  = &keys[0];
-        const uint8_t * seedptr = &seeds[0];
-        seed_t curseed = 0, hseed1, hseed2;
-        for (unsigned i = 0; i < keycount; i++) {
-            memcpy(&curseed, seedptr, seedbytes);
-            curseed = hinfo->getFixedSeed(curseed);
-
-            addVCodeInput(curseed);
-            hseed1 = hinfo->Seed(curseed, HashInfo::SEED_FORCED);
-            hash(keyptr, keybytes, hseed1, &hashes[2 * i]);
-
-            curseed ^= (UINT64_C(1) << seedbit);
-
-            addVCodeInput(curseed);
-            hseed2 = hinfo->Seed(curseed, HashInfo::SEED_FORCED);
-            hash(keyptr, keybytes, hseed2, &hashes[2 * i + 1]);
-
-            keyptr  += keybytes;
-            seedptr += seedbytes;
-        }
+        vcode_redirect          = &results[seedbit].vcode;
+        g_log2pValueCountsLocal = results[seedbit].log2pcounts;
+
+        SeedBitflipHashes<hashtype>(hinfo, keybytes, seedbytes, seedbit, keycount,
+                seqs[2 * seedbit], seqs[2 * seedbit + 1], keys, seeds, hashes);
 
         auto keyprint = [&]( hidx_t i ) {
             ExtBlob k(&keys[(i >> 1) * keybytes], keybytes);
@@ -140,44 +151,124 @@ static bool SeedBitflipTestImpl( const HashInfo * hinfo, unsigned keybits, flags
             v.printhex(NULL);
         };
 
-        // If VERBOSE reporting isn't enabled, then each test isn't being
-        // reported on, and so there might need to be a failure summary at
-        // the end of testing. If that's true, then keep a copy of the
-        // original list of hashes, since TestHashList() will modify it.
-        if (!REPORT(VERBOSE, flags)) {
-            hashes_copy = hashes;
-        }
-
         int  curlogp    = 0;
         bool thisresult = TestHashList(hashes).testDistribution(true).
                 reportFlags(flags).quiet(!REPORT(VERBOSE, flags)).
                 sumLogp(&curlogp).testDeltas(2).dumpFailKeys(keyprint);
 
+        addVCodeResult(thisresult);
+
+        results[seedbit].logp   = curlogp;
+        results[seedbit].result = thisresult;
+
         if (REPORT(VERBOSE, flags)) {
             printf("\n");
         } else {
-            progressdots(seedbit, 0, seedbits - 1, 10);
-            // Record worst result, but don't let a pass override a failure
-            if ((fails == 0) && !thisresult) {
-                worstlogp = -1;
-            }
-            if (((fails == 0) || !thisresult) && (worstlogp < curlogp)) {
-                worstlogp    = curlogp;
-                worstseedbit = seedbit;
-                worsthashes  = hashes_copy;
-            }
-            if (!thisresult) {
-                fails++;
-            }
+            progressdots(ndone++, 0, seedbits - 1, 10);
         }
+    }
 
-        addVCodeResult(thisresult);
+    vcode_redirect          = NULL;
+    g_log2pValueCountsLocal = NULL;
+}
+
+template <typename hashtype, bool bigseed>
+static bool SeedBitflipTestImpl( const HashInfo * hinfo, unsigned keybits, flags_t flags ) {
+    unsigned       seedbytes = bigseed ? 8 : 4;
+    unsigned       seedbits  = seedbytes * 8;
+    unsigned       keybytes  = keybits / 8;
+    const unsigned keycount  = 512 * 1024 * 3;
+
+    // Use a new sequence of keys and a new sequence of seeds for every
+    // seed bit tested. Note that SEQ_DIST_2 is enough to ensure there are
+    // no seed collisions, because only 1 bit _position_ is flipped per set
+    // of seeds, and (x ^ N) ^ (y ^ N) == x ^ y, which must have at least 2
+    // set bits. These are all made up front, in seed bit order.
+    Rand r( 18734, keybytes );
+    std::vector<RandSeq> seqs;
+    for (unsigned seedbit = 0; seedbit < seedbits; seedbit++) {
+        seqs.push_back(r.get_seq(SEQ_DIST_1, keybytes ));
+        seqs.push_back(r.get_seq(SEQ_DIST_2, seedbytes));
+    }
 
-        result &= thisresult;
+    // See BitflipTestImpl() for how many seed bits are run at once.
+    const uint64_t bitmem   = (uint64_t)keycount * (keybytes + seedbytes + 2 * sizeof(hashtype) * 3);
+    unsigned       nthreads = std::min(g_NCPU, seedbits);
+    const uint64_t maxmem   = (g_maxMemory != 0) ? g_maxMemory : DEFAULT_PARALLEL_MEMORY;
+    nthreads = std::max((uint64_t)1, std::min((uint64_t)nthreads, maxmem / bitmem));
+    if (REPORT(VERBOSE, flags)) {
+        nthreads = 1;
     }
 
+    std::vector<SeedBitflipResult> results( seedbits );
+    a_uint iseedbit( 0 ), ndone( 0 );
+
+    if (!REPORT(VERBOSE, flags)) {
+        printf("Testing %3d-byte keys, %2d-bit seeds, %d reps", keybytes, seedbits, keycount);
+    }
+
+    if (nthreads == 1) {
+        SeedBitflipTestBits<hashtype>(hinfo, keybits, seedbits, keycount, seqs, iseedbit, ndone, &results[0], flags);
+    } else {
+#if defined(HAVE_THREADS)
+        std::vector<std::thread> t( nthreads );
+        for (unsigned i = 0; i < nthreads; i++) {
+            t[i] = std::thread {
+                [&] {
+                    g_inParallel = true;
+                    SeedBitflipTestBits<hashtype>(hinfo, keybits, seedbits, keycount, seqs,
+                            iseedbit, ndone, &results[0], flags);
+                }
+            };
+        }
+        for (unsigned i = 0; i < nthreads; i++) {
+            t[i].join();
+        }
+#endif
+    }
+
+    int  worstlogp    = -1;
+    int  worstseedbit = -1;
+    int  fails        =  0;
+    bool result       = true;
+
+    for (unsigned seedbit = 0; seedbit < seedbits; seedbit++) {
+        const SeedBitflipResult & res = results[seedbit];
+
+        mergeVCodeChunks(&res.vcode, 1);
+        mergeLog2PValueCounts(res.log2pcounts);
+
+        // Record worst result, but don't let a pass override a failure
+        if ((fails == 0) && !res.result) {
+            worstlogp = -1;
+        }
+        if (((fails == 0) || !res.result) && (worstlogp < res.logp)) {
+            worstlogp    = res.logp;
+            worstseedbit = seedbit;
+        }
+        if (!res.result) {
+            fails++;
+        }
+
+        result &= res.result;
+    }
+
+    // If VERBOSE reporting isn't enabled, then each test wasn't reported
+    // on, so print a summary of the worst one. Its hashes are regenerated
+    // into a scratch VCode chunk, since they were already counted.
     if (!REPORT(VERBOSE, flags)) {
         printf("%3d failed, worst is seed bit %3d%s\n", fails, worstseedbit, result ? "" : "   !!!!!");
+
+        std::vector<hashtype> worsthashes( keycount * 2 );
+        std::vector<uint8_t>  keys( keycount * keybytes );
+        std::vector<uint8_t>  seeds( keycount * seedbytes );
+        vcode_chunk_t         scratch = {};
+
+        vcode_redirect = &scratch;
+        SeedBitflipHashes<hashtype>(hinfo, keybytes, seedbytes, worstseedbit, keycount,
+                seqs[2 * worstseedbit], seqs[2 * worstseedbit + 1], keys, seeds, worsthashes);
+        vcode_redirect = NULL;
+
         bool ignored = TestHashList(worsthashes).testDistribution(true).testDeltas(2);
         unused(ignored);
         printf("\n");
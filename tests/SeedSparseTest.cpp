@@ -102,7 +102,8 @@ static bool SeedSparseTestImpl( const HashInfo * hinfo, uint32_t keylen, flags_t
         } while (iseed != 0);
     }
 
-    auto keyprint = [&]( hidx_t i ) {
+    auto keyprint = [&]( hidx_t n ) {
+        uint32_t i       = n;
         seed_t   setbits = InverseKChooseUpToK(i, 0, maxbits, bigseed ? 64 : 32);
         seed_t   iseed   = nthlex(i, setbits);
         seed_t   hseed   = hinfo->Seed(iseed, HashInfo::SEED_FORCED);
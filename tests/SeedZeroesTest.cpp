@@ -100,8 +100,9 @@ static bool SeedZeroKeyImpl( const HashInfo * hinfo, const size_t maxbits, const
         } while (seed != 0);
     }
 
-    auto keyprint = [&]( hidx_t i ) {
-        hidx_t   keylen  = 1 + (i % keycount); i /= keycount;
+    auto keyprint = [&]( hidx_t n ) {
+        uint32_t i       = n;
+        uint32_t keylen  = 1 + (i % keycount); i /= keycount;
         bool     negate  = (i & 1);            i /= 2;
         seed_t   setbits = InverseKChooseUpToK(i, 1, maxbits, bigseed ? 64 : 32);
         seed_t   iseed   = nthlex(i, setbits); if (negate) { iseed = ~iseed; }
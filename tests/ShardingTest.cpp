@@ -0,0 +1,254 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+#include "Platform.h"
+#include "Timing.h"
+#include "Hashinfo.h"
+#include "TestGlobals.h"
+#include "Stats.h" // For ChiSqPValue, GetBoundedPoissonPValue, ScalePValue
+#include "Reporting.h"
+#include "Instantiate.h"
+#include "VCode.h"
+
+#include "ShardingTest.h"
+
+#include <string>
+
+//-----------------------------------------------------------------------------
+// Sharding tests - route structured key populations to N shards using
+// the common schemes built on top of a hash (hash modulo N, jump
+// consistent hashing, and rendezvous hashing), and measure how evenly
+// the keys are spread over the shards. Hashes which look fine in the
+// power-of-two-sized windows examined by the distribution tests can
+// still skew badly under modulo a non-power-of-two.
+//
+// Each result is scored by the more unlikely of the chi-square
+// goodness-of-fit of the shard loads and the probability of the maximum
+// shard load, and the max/mean load ratio is shown. Routing times are
+// also reported, but they do not inform VCodes.
+
+static const uint32_t shardcounts[] = { 3, 10, 37, 100, 1000, 10000 };
+
+// Rendezvous hashing costs N hashes per key, so it uses a smaller number
+// of keys, and is not run for the largest shard counts.
+static const uint64_t RENDEZVOUS_HASHES    = UINT64_C(1) << 22;
+static const uint32_t RENDEZVOUS_MAXSHARDS = 100;
+
+enum ShardScheme {
+    SHARD_MODULO,
+    SHARD_JUMP,
+    SHARD_RENDEZVOUS,
+};
+
+static const char * shardschemenames[] = { "Mod-N", "Jump", "Rendezvous" };
+
+// Sharding is done on the first 64 bits of the hash, or the whole hash if
+// it is narrower than that.
+template <typename hashtype>
+static FORCE_INLINE uint64_t ShardHashValue( const hashtype & h ) {
+    if (sizeof(hashtype) >= 8) {
+        uint64_t v;
+        memcpy(&v, &h, 8);
+        return v;
+    } else {
+        uint32_t v;
+        memcpy(&v, &h, 4);
+        return v;
+    }
+}
+
+// From "A Fast, Minimal Memory, Consistent Hash Algorithm", by John
+// Lamping and Eric Veach
+static FORCE_INLINE uint32_t JumpConsistentHash( uint64_t key, const uint32_t buckets ) {
+    int64_t b = -1, j = 0;
+
+    while (j < buckets) {
+        b   = j;
+        key = key * UINT64_C(2862933555777941757) + 1;
+        j   = (int64_t)((double)(b + 1) * ((double)(INT64_C(1) << 31) / (double)((key >> 33) + 1)));
+    }
+    return (uint32_t)b;
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype>
+static uint64_t ShardKeys( HashFn hash, const seed_t seed, const std::vector<std::string> & keys,
+        const uint64_t keycount, const ShardScheme scheme, const uint32_t shards,
+        std::vector<uint32_t> & loads ) {
+    std::vector<uint8_t> buf;
+    uint64_t begin, end;
+    hashtype h;
+
+    std::fill(loads.begin(), loads.end(), 0);
+
+    begin = monotonic_clock();
+    for (uint64_t i = 0; i < keycount; i++) {
+        const std::string & key = keys[i];
+        uint32_t shard = 0;
+
+        switch (scheme) {
+        case SHARD_MODULO:
+            hash(key.c_str(), key.length(), seed, &h);
+            shard = (uint32_t)(ShardHashValue(h) % shards);
+            break;
+        case SHARD_JUMP:
+            hash(key.c_str(), key.length(), seed, &h);
+            shard = JumpConsistentHash(ShardHashValue(h), shards);
+            break;
+        case SHARD_RENDEZVOUS: {
+            // The weight of each shard is the hash of the key with the
+            // shard number appended to it.
+            uint64_t maxweight = 0;
+            buf.assign(key.begin(), key.end());
+            buf.resize(key.length() + 4);
+            for (uint32_t s = 0; s < shards; s++) {
+                PUT_U32<false>(s, &buf[key.length()], 0);
+                hash(&buf[0], buf.size(), seed, &h);
+                const uint64_t weight = ShardHashValue(h);
+                if ((s == 0) || (weight > maxweight)) {
+                    maxweight = weight;
+                    shard     = s;
+                }
+            }
+            break;
+        }
+        }
+
+        loads[shard]++;
+    }
+    end = monotonic_clock();
+
+    return end - begin;
+}
+
+static bool ShardReport( const ShardScheme scheme, const uint32_t shards, const uint64_t keycount,
+        const std::vector<uint32_t> & loads, const double ns_per_key, flags_t flags ) {
+    const double expected = (double)keycount / (double)shards;
+    uint32_t     maxload  = 0;
+    double       chisq    = 0.0;
+
+    for (uint32_t s = 0; s < shards; s++) {
+        const double delta = (double)loads[s] - expected;
+        chisq  += delta * delta / expected;
+        maxload = std::max(maxload, loads[s]);
+    }
+
+    addVCodeResult(loads.data(), shards * sizeof(loads[0]));
+
+    const double p_chisq = ChiSqPValue(chisq, shards - 1);
+    const double p_max   = ScalePValue(GetBoundedPoissonPValue(expected, maxload), shards);
+    const double p_value = ScalePValue(std::min(p_chisq, p_max), 2);
+
+    if (!REPORT(QUIET, flags)) {
+        printf("%-10s %5d shards, %7" PRIu64 " keys: %7.2f ns/key - max/mean load %7.4f ",
+                shardschemenames[scheme], shards, keycount, ns_per_key, (double)maxload / expected);
+    }
+
+    return ReportPValue(p_value, NULL, flags);
+}
+
+template <typename hashtype>
+static bool ShardingImpl( const HashInfo * hinfo, const seed_t seed, const char * keysetname,
+        const std::vector<std::string> & keys, flags_t flags ) {
+    const HashFn hash   = hinfo->hashFn(g_hashEndian);
+    bool         result = true;
+
+    std::vector<uint32_t> loads;
+
+    printf("Keyset '%s' - %zu keys\n", keysetname, keys.size());
+
+    for (const std::string & key: keys) {
+        addVCodeInput(key.c_str(), key.length());
+    }
+
+    for (ShardScheme scheme: { SHARD_MODULO, SHARD_JUMP, SHARD_RENDEZVOUS }) {
+        for (uint32_t shards: shardcounts) {
+            uint64_t keycount = keys.size();
+
+            if (scheme == SHARD_RENDEZVOUS) {
+                if (shards > RENDEZVOUS_MAXSHARDS) {
+                    continue;
+                }
+                keycount = std::min(keycount, RENDEZVOUS_HASHES / shards);
+            }
+
+            loads.resize(shards);
+            uint64_t elapsed = ShardKeys<hashtype>(hash, seed, keys, keycount, scheme, shards, loads);
+
+            result &= ShardReport(scheme, shards, keycount, loads,
+                    (double)elapsed / (double)keycount, flags);
+        }
+    }
+
+    printf("\n");
+
+    recordTestResult(result, "Sharding", keysetname);
+
+    addVCodeResult(result);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype>
+bool ShardingTest( const HashInfo * hinfo, bool extra, flags_t flags ) {
+    const seed_t   seed     = hinfo->Seed(g_seed);
+    uint32_t       keycount = extra ? (1 << 22) : (1 << 20);
+    bool           result   = true;
+
+    printf("[[[ 'Sharding' Tests ]]]\n\n");
+
+    if (hinfo->isVerySlow()) {
+        keycount /= 16;
+    }
+
+    // Sequential 64-bit integer IDs
+    {
+        std::vector<std::string> keys( keycount, std::string( 8, '\0' ));
+        for (uint32_t i = 0; i < keycount; i++) {
+            PUT_U64<false>(i, (uint8_t *)&keys[i][0], 0);
+        }
+        result &= ShardingImpl<hashtype>(hinfo, seed, "Sequential", keys, flags);
+    }
+
+    // Tenant-prefixed strings, for 100 tenants
+    {
+        std::vector<std::string> keys( keycount );
+        for (uint32_t i = 0; i < keycount; i++) {
+            keys[i] = "tenant" + std::to_string(i % 100) + "/user" + std::to_string(i / 100);
+        }
+        result &= ShardingImpl<hashtype>(hinfo, seed, "Tenant", keys, flags);
+    }
+
+    // Numbers in text form, as in the TextNum keyset
+    {
+        std::vector<std::string> keys( keycount );
+        for (uint32_t i = 0; i < keycount; i++) {
+            keys[i] = std::to_string(i);
+        }
+        result &= ShardingImpl<hashtype>(hinfo, seed, "TextNum", keys, flags);
+    }
+
+    printf("%s\n", result ? "" : g_failstr);
+
+    return result;
+}
+
+INSTANTIATE(ShardingTest, HASHTYPELIST);
@@ -0,0 +1,425 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+#include "Platform.h"
+#include "Timing.h"
+#include "Hashinfo.h"
+#include "TestGlobals.h"
+#include "Stats.h" // For ChiSqPValue
+#include "Random.h"
+#include "Reporting.h"
+#include "Wordlist.h"
+#include "Instantiate.h"
+#include "VCode.h"
+
+#include "SketchTest.h"
+
+#include <math.h>
+
+//-----------------------------------------------------------------------------
+// Sketch tests - feed keysets through HyperLogLog cardinality estimators
+// and a count-min frequency sketch, and compare the distribution of their
+// errors against that of a random oracle. HyperLogLog is sensitive to
+// bias in the register index bits and in the leading-zero counts of the
+// remaining bits, and count-min sketches are sensitive to correlations
+// between the slices of the hash used to pick cells in each row.
+//
+// Each keyset is split into SKETCH_CHUNKS contiguous chunks, and each
+// chunk gets its own sketch. The same sketches are also fed with
+// ORACLE_CHUNKS chunks of truly random values of the same width as the
+// hash, which gives the ideal error distribution for chunks of that
+// size. The chunk errors from the hash are then scored against that
+// distribution with a chi-square test.
+//
+// Update times are also reported, but they do not inform VCodes.
+
+static const uint32_t SKETCH_CHUNKS = 64;
+static const uint32_t ORACLE_CHUNKS = 16 * SKETCH_CHUNKS;
+static const uint32_t CMS_DEPTH     = 4;
+static const uint32_t CMS_WIDTH     = 1024;
+
+// Sketch inputs are the first 64 bits of the hash, left-justified if the
+// hash is narrower than that.
+template <typename hashtype>
+static FORCE_INLINE uint64_t SketchHashValue( const hashtype & h ) {
+    if (sizeof(hashtype) >= 8) {
+        uint64_t v;
+        memcpy(&v, &h, 8);
+        return v;
+    } else {
+        uint32_t v;
+        memcpy(&v, &h, 4);
+        return (uint64_t)v << 32;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// HyperLogLog, using the top p bits of the hash as the register index,
+// and Ertl's improved raw estimator ("New cardinality estimation
+// algorithms for HyperLogLog sketches", 2017), which needs no bias
+// correction tables or switchover to linear counting.
+
+class HyperLogLog {
+  private:
+    std::vector<uint8_t>  regs;
+    std::vector<uint32_t> counts;
+    const unsigned        p, q;
+
+    static double sigma( double x ) {
+        if (x == 1.0) { return INFINITY; }
+        double y = 1.0, z = x, zprev;
+        do {
+            x    *= x;
+            zprev = z;
+            z    += x * y;
+            y    += y;
+        } while (z != zprev);
+        return z;
+    }
+
+    static double tau( double x ) {
+        if ((x == 0.0) || (x == 1.0)) { return 0.0; }
+        double y = 1.0, z = 1.0 - x, zprev;
+        do {
+            x     = sqrt(x);
+            zprev = z;
+            y    *= 0.5;
+            z    -= (1.0 - x) * (1.0 - x) * y;
+        } while (z != zprev);
+        return z / 3.0;
+    }
+
+  public:
+    HyperLogLog( unsigned precision, unsigned hashbits ) :
+        regs( 1 << precision ), counts( hashbits - precision + 2 ),
+        p( precision ), q( hashbits - precision ) {}
+
+    void clear( void ) {
+        std::fill(regs.begin(), regs.end(), 0);
+    }
+
+    FORCE_INLINE void add( uint64_t v ) {
+        const uint64_t idx  = v >> (64 - p);
+        const uint64_t rest = v << p;
+        const uint8_t  rank = (rest == 0) ? q + 1 : std::min((unsigned)clz8(rest) + 1, q + 1);
+
+        if (regs[idx] < rank) { regs[idx] = rank; }
+    }
+
+    double estimate( void ) {
+        const double m = (double)regs.size();
+
+        std::fill(counts.begin(), counts.end(), 0);
+        for (uint8_t r: regs) { counts[r]++; }
+
+        double z = m * tau(1.0 - (double)counts[q + 1] / m);
+        for (unsigned k = q; k >= 1; k--) {
+            z = 0.5 * (z + (double)counts[k]);
+        }
+        z += m * sigma((double)counts[0] / m);
+
+        return 0.5 / M_LN2 * m * m / z;
+    }
+}; // class HyperLogLog
+
+//-----------------------------------------------------------------------------
+// Count-min sketch, picking the cell in each row via double hashing on
+// the two 32-bit halves of the hash value. Narrow hashes have to derive
+// the second half from the first.
+
+class CountMinSketch {
+  private:
+    std::vector<uint32_t> cells;
+
+    static FORCE_INLINE void hashpair( uint64_t v, uint32_t & h1, uint32_t & h2 ) {
+        h1 = (uint32_t)(v >> 32);
+        h2 = (uint32_t)v;
+        if (h2 == 0) {
+            h2 = ROTL32(h1 * UINT32_C(0x9E3779B9), 16);
+        }
+    }
+
+    static FORCE_INLINE uint32_t cell( uint32_t row, uint32_t h1, uint32_t h2 ) {
+        return row * CMS_WIDTH + (uint32_t)(((uint64_t)(h1 + row * h2) * CMS_WIDTH) >> 32);
+    }
+
+  public:
+    CountMinSketch( void ) : cells( CMS_DEPTH * CMS_WIDTH ) {}
+
+    void clear( void ) {
+        std::fill(cells.begin(), cells.end(), 0);
+    }
+
+    FORCE_INLINE void add( uint64_t v, uint32_t count ) {
+        uint32_t h1, h2;
+
+        hashpair(v, h1, h2);
+        for (uint32_t row = 0; row < CMS_DEPTH; row++) {
+            cells[cell(row, h1, h2)] += count;
+        }
+    }
+
+    FORCE_INLINE uint32_t query( uint64_t v ) const {
+        uint32_t h1, h2, est = UINT32_MAX;
+
+        hashpair(v, h1, h2);
+        for (uint32_t row = 0; row < CMS_DEPTH; row++) {
+            est = std::min(est, cells[cell(row, h1, h2)]);
+        }
+        return est;
+    }
+}; // class CountMinSketch
+
+// Each distinct item in a chunk is given a small, varying true count
+static FORCE_INLINE uint32_t CMSItemCount( size_t i ) {
+    return 1 + (i % 7);
+}
+
+//-----------------------------------------------------------------------------
+// Chunk runners. getval(i) returns the sketch input for the i'th item in
+// the chunk, either from hashing a key or from the random oracle. Each
+// returns the total time spent on updates, in nanoseconds.
+
+template <typename valfn>
+static uint64_t HLLChunk( HyperLogLog & hll, const size_t count, valfn getval, double & relerr ) {
+    uint64_t begin, end;
+
+    hll.clear();
+
+    begin = monotonic_clock();
+    for (size_t i = 0; i < count; i++) {
+        hll.add(getval(i));
+    }
+    end   = monotonic_clock();
+
+    const double est = hll.estimate();
+    addVCodeResult((uint32_t)est);
+    relerr = est / (double)count - 1.0;
+
+    return end - begin;
+}
+
+template <typename valfn>
+static uint64_t CMSChunk( CountMinSketch & cms, const size_t count, valfn getval,
+        std::vector<uint64_t> & vals, double & overcount ) {
+    uint64_t begin, end, over = 0;
+
+    cms.clear();
+
+    begin = monotonic_clock();
+    for (size_t i = 0; i < count; i++) {
+        vals[i] = getval(i);
+        cms.add(vals[i], CMSItemCount(i));
+    }
+    end   = monotonic_clock();
+
+    for (size_t i = 0; i < count; i++) {
+        over += cms.query(vals[i]) - CMSItemCount(i);
+    }
+    addVCodeResult(over);
+    overcount = (double)over / (double)count;
+
+    return end - begin;
+}
+
+//-----------------------------------------------------------------------------
+// Scores the per-chunk errors from the hash against the mean and variance
+// of the errors from the random oracle. For HyperLogLog the RMS relative
+// error is shown; for count-min the mean overcount per item is shown.
+
+static bool SketchReport( const char * desc, const double ns_per_item, const std::vector<double> & errs,
+        const std::vector<double> & oracle, const bool isrelative, flags_t flags ) {
+    double o_mean = 0.0, o_sumsq = 0.0, h_mean = 0.0, h_sumsq = 0.0;
+
+    for (double e: oracle) { o_mean += e; o_sumsq += e * e; }
+    for (double e: errs)   { h_mean += e; h_sumsq += e * e; }
+    o_mean /= (double)oracle.size();
+    h_mean /= (double)errs.size();
+
+    const double o_var = o_sumsq / (double)oracle.size() - o_mean * o_mean;
+    double       chisq = 0.0;
+    for (double e: errs) {
+        chisq += (e - o_mean) * (e - o_mean) / o_var;
+    }
+    const double p_value = ChiSqPValue(chisq, errs.size());
+
+    if (!REPORT(QUIET, flags)) {
+        if (isrelative) {
+            const double h_rms = sqrt(h_sumsq / (double)errs.size());
+            const double o_rms = sqrt(o_sumsq / (double)oracle.size());
+            printf("%-22s %7.2f ns/item - RMS error  %7.3f%%, ideal %7.3f%% (%5.3fx) ",
+                    desc, ns_per_item, 100.0 * h_rms, 100.0 * o_rms, h_rms / o_rms);
+        } else {
+            printf("%-22s %7.2f ns/item - mean overcount %7.3f, ideal %7.3f (%5.3fx) ",
+                    desc, ns_per_item, h_mean, o_mean, h_mean / o_mean);
+        }
+    }
+
+    return ReportPValue(p_value, NULL, flags);
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype>
+static bool SketchImpl( const HashInfo * hinfo, const seed_t seed, const char * keysetname,
+        const std::vector<std::string> & keys, const std::vector<unsigned> & precisions, flags_t flags ) {
+    const HashFn   hash     = hinfo->hashFn(g_hashEndian);
+    const unsigned hashbits = std::min(hinfo->bits, (uint32_t)64);
+    const uint64_t hashmask = UINT64_C(0xFFFFFFFFFFFFFFFF) << (64 - hashbits);
+    const size_t   chunksz  = keys.size() / SKETCH_CHUNKS;
+    bool           result   = true;
+
+    std::vector<uint64_t> vals( chunksz );
+    std::vector<double>   errs( SKETCH_CHUNKS ), oracle( ORACLE_CHUNKS );
+    uint64_t elapsed;
+
+    printf("Keyset '%s' - %zu keys, %d chunks of %zu keys\n", keysetname,
+            chunksz * SKETCH_CHUNKS, SKETCH_CHUNKS, chunksz);
+
+    for (size_t i = 0; i < chunksz * SKETCH_CHUNKS; i++) {
+        addVCodeInput(keys[i].c_str(), keys[i].length());
+    }
+
+    auto hashval = [&]( size_t chunk ) {
+                return [&, chunk]( size_t i ) {
+                           const std::string & key = keys[chunk * chunksz + i];
+                           hashtype            h;
+                           hash(key.c_str(), key.length(), seed, &h);
+                           return SketchHashValue(h);
+                       };
+            };
+    auto randval = [&]( Rand & r ) {
+                return [&]( size_t i ) {
+                           unused(i);
+                           return r.rand_u64() & hashmask;
+                       };
+            };
+
+    for (unsigned p: precisions) {
+        HyperLogLog hll( p, hashbits );
+        Rand        r( 670981 + p );
+        char        desc[32];
+
+        for (uint32_t c = 0; c < ORACLE_CHUNKS; c++) {
+            HLLChunk(hll, chunksz, randval(r), oracle[c]);
+        }
+        elapsed = 0;
+        for (uint32_t c = 0; c < SKETCH_CHUNKS; c++) {
+            elapsed += HLLChunk(hll, chunksz, hashval(c), errs[c]);
+        }
+
+        snprintf(desc, sizeof(desc), "HyperLogLog p=%2d:", p);
+        result &= SketchReport(desc, (double)elapsed / (double)(chunksz * SKETCH_CHUNKS),
+                errs, oracle, true, flags);
+    }
+
+    {
+        CountMinSketch cms;
+        Rand           r( 670933 );
+        char           desc[32];
+
+        for (uint32_t c = 0; c < ORACLE_CHUNKS; c++) {
+            CMSChunk(cms, chunksz, randval(r), vals, oracle[c]);
+        }
+        elapsed = 0;
+        for (uint32_t c = 0; c < SKETCH_CHUNKS; c++) {
+            elapsed += CMSChunk(cms, chunksz, hashval(c), vals, errs[c]);
+        }
+
+        snprintf(desc, sizeof(desc), "Count-min %dx%d:", CMS_DEPTH, CMS_WIDTH);
+        result &= SketchReport(desc, (double)elapsed / (double)(chunksz * SKETCH_CHUNKS),
+                errs, oracle, false, flags);
+    }
+
+    printf("\n");
+
+    recordTestResult(result, "Sketch", keysetname);
+
+    addVCodeResult(result);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+template <typename hashtype>
+bool SketchTest( const HashInfo * hinfo, bool extra, flags_t flags ) {
+    const seed_t seed   = hinfo->Seed(g_seed);
+    bool         result = true;
+
+    std::vector<unsigned> precisions = { 8, 11, 14 };
+    if (extra) {
+        precisions.push_back(16);
+    }
+
+    printf("[[[ 'Sketch' Tests ]]]\n\n");
+
+    // Words from the dictionary
+    {
+        std::vector<std::string> keys = GetWordlist(CASE_ALL, REPORT(VERBOSE, flags)).strings();
+        if (keys.size() < SKETCH_CHUNKS) {
+            printf("WARNING: Wordlist initialization failed! Skipping Words keyset.\n\n");
+        } else {
+            result &= SketchImpl<hashtype>(hinfo, seed, "Words", keys, precisions, flags);
+        }
+    }
+
+    // Text keys of the form "FooXXXXBar"
+    {
+        const char *   alnum     = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+        const unsigned corecount = (unsigned)strlen(alnum);
+        const unsigned keycount  = 1 << 20;
+        std::vector<std::string> keys( keycount, "FooXXXXBar" );
+        for (unsigned i = 0; i < keycount; i++) {
+            unsigned n = i;
+            for (unsigned j = 0; j < 4; j++) {
+                keys[i][3 + j] = alnum[n % corecount]; n /= corecount;
+            }
+        }
+        result &= SketchImpl<hashtype>(hinfo, seed, "Text", keys, precisions, flags);
+    }
+
+    // 128-bit keys with up to 3 bits set
+    {
+        std::vector<std::string> keys;
+        std::string key( 16, '\0' );
+        keys.push_back(key);
+        for (unsigned a = 0; a < 128; a++) {
+            key[a / 8] ^= 1 << (a % 8);
+            keys.push_back(key);
+            for (unsigned b = a + 1; b < 128; b++) {
+                key[b / 8] ^= 1 << (b % 8);
+                keys.push_back(key);
+                for (unsigned c = b + 1; c < 128; c++) {
+                    key[c / 8] ^= 1 << (c % 8);
+                    keys.push_back(key);
+                    key[c / 8] ^= 1 << (c % 8);
+                }
+                key[b / 8] ^= 1 << (b % 8);
+            }
+            key[a / 8] ^= 1 << (a % 8);
+        }
+        result &= SketchImpl<hashtype>(hinfo, seed, "Sparse", keys, precisions, flags);
+    }
+
+    printf("%s\n", result ? "" : g_failstr);
+
+    return result;
+}
+
+INSTANTIATE(SketchTest, HASHTYPELIST);
@@ -51,92 +51,225 @@
 #include "Hashinfo.h"
 #include "TestGlobals.h"
 #include "Stats.h"
+#include "Blobsort.h"
+#include "VCode.h"
+#include "HashSpill.h"
 #include "Analyze.h"
 #include "Instantiate.h"
-#include "VCode.h"
 
 #include "SparseKeysetTest.h"
 
 //-----------------------------------------------------------------------------
 // Keyset 'Sparse' - generate all possible N-bit keys with up to K bits set
+//
+// Keys are produced in the order of a depth-first walk over increasing set
+// bit positions: {}, {0}, {0,1}, ..., {0,1,N-1}, {0,2}, {0,2,3}, ... The
+// key at any rank in that order can be computed directly, and each key
+// differs from the one before it by at most 3 bit flips (usually 1 or 2),
+// so the keyset is split into rank ranges which are generated and hashed
+// independently, directly into their slots of the hash list.
+//
+// The hashes are collected into either a std::vector or, if --max-memory
+// says that they won't fit, a HashSpillDeltas.
+
+template <typename keytype>
+class SparseKeyIter {
+  public:
+    SparseKeyIter( const unsigned setbits, const bool inclusive, uint64_t rank ) :
+        pos( setbits ), count( 0 ), setbits( setbits ), inclusive( inclusive ) {
+        const unsigned keybits = keytype::bitlen;
+        unsigned       p       = 0;
+        uint64_t       t;
 
-template <typename keytype, typename hashtype>
-static void SparseKeygenRecurse( HashFn hash, const seed_t seed, unsigned start, unsigned bitsleft,
-        bool inclusive, keytype & k, std::vector<hashtype> & hashes ) {
-    hashtype h;
-
-    for (size_t i = start; i < k.bitlen; i++) {
-        k.flipbit(i);
+        k = 0;
+        if (inclusive) {
+            // This loop is very close to the loop in
+            // PermutationKeysetTest.cpp, so the explanatory comments there
+            // also apply here, except that a) there are only two choices
+            // for each position, and b) there are a limited number of
+            // allowed 1 bits, while counts of block occurrences in
+            // Permutation are not limited. That is why this loop uses
+            // chooseUpToK() instead of a table, and why it uses the
+            // laterbits variable at all.
+            uint64_t laterbits = setbits;
+            while (rank > 0) {
+                laterbits--;
+                rank--;
+                while (rank >= (t = 1 + chooseUpToK(keybits - 1 - p, laterbits))) {
+                    rank -= t;
+                    p++;
+                }
+                add(p++);
+            }
+        } else {
+            for (unsigned i = 0; i < setbits; i++) {
+                while (rank >= (t = chooseK(keybits - 1 - p, setbits - 1 - i))) {
+                    rank -= t;
+                    p++;
+                }
+                add(p++);
+            }
+        }
+    }
 
-        if (inclusive || (bitsleft == 1)) {
-            hash(&k, k.len, seed, &h);
-            addVCodeInput(&k, k.len);
-            hashes.push_back(h);
+    const keytype & key( void ) const { return k; }
+
+    // Advance to the key with the next rank. This must not be called on
+    // the last key.
+    void next( void ) {
+        const unsigned keybits = keytype::bitlen;
+
+        if (inclusive) {
+            if (count == 0) {
+                add(0);
+            } else if (pos[count - 1] + 1 < keybits) {
+                if (count < setbits) {
+                    add(pos[count - 1] + 1);
+                } else {
+                    move(count - 1);
+                }
+            } else {
+                k.flipbit(pos[--count]);
+                move(count - 1);
+            }
+        } else {
+            unsigned i = count - 1;
+            while (pos[i] == keybits - setbits + i) {
+                i--;
+            }
+            for (unsigned j = i; j < count; j++) {
+                k.flipbit(pos[j]);
+            }
+            pos[i]++;
+            k.flipbit(pos[i]);
+            for (unsigned j = i + 1; j < count; j++) {
+                pos[j] = pos[j - 1] + 1;
+                k.flipbit(pos[j]);
+            }
         }
+    }
+
+  private:
+    void add( unsigned p ) {
+        pos[count++] = p;
+        k.flipbit(p);
+    }
+
+    void move( unsigned i ) {
+        k.flipbit(pos[i]);
+        k.flipbit(++pos[i]);
+    }
+
+    keytype                k;
+    std::vector<unsigned>  pos;
+    unsigned               count;
+    const unsigned         setbits;
+    const bool             inclusive;
+};
 
-        if (bitsleft > 1) {
-            SparseKeygenRecurse(hash, seed, i + 1, bitsleft - 1, inclusive, k, hashes);
+template <typename keytype, typename hashtype>
+static void SparseKeygenRange( HashFn hash, const seed_t seed, const unsigned setbits, bool inclusive,
+        uint64_t first, uint64_t last, hashtype * hashes, vcode_chunk_t & vcode ) {
+    SparseKeyIter<keytype> it( setbits, inclusive, first );
+
+    for (uint64_t n = first; n < last; n++) {
+        if (n != first) {
+            it.next();
         }
+        hash(&it.key(), keytype::len, seed, &hashes[n - first]);
+        addVCodeInput(vcode, &it.key(), keytype::len);
+    }
+}
+
+static const uint64_t SPARSE_THREAD_MIN  = 1 << 14;
+static const uint64_t SPARSE_SPILL_BATCH = 1 << 20;
 
-        k.flipbit(i);
+// Hash the keys with ranks [first, first + count) into hashes[0..count-1],
+// splitting the range across g_NCPU threads if it is large enough.
+
+template <typename keytype, typename hashtype>
+static void SparseKeygen( HashFn hash, const seed_t seed, const unsigned setbits, bool inclusive,
+        uint64_t first, uint64_t count, hashtype * hashes ) {
+    const unsigned nthreads = (count >= SPARSE_THREAD_MIN * g_NCPU) ? g_NCPU : 1;
+    std::vector<vcode_chunk_t> vcodes( nthreads );
+
+    if (nthreads == 1) {
+        SparseKeygenRange<keytype, hashtype>(hash, seed, setbits, inclusive,
+                first, first + count, hashes, vcodes[0]);
+    } else {
+#if defined(HAVE_THREADS)
+        std::vector<std::thread> t( nthreads );
+        for (unsigned i = 0; i < nthreads; i++) {
+            const uint64_t lo = count * i / nthreads;
+            const uint64_t hi = count * (i + 1) / nthreads;
+            t[i] = std::thread {
+                SparseKeygenRange<keytype, hashtype>, hash, seed, setbits, inclusive,
+                first + lo, first + hi, &hashes[lo], std::ref(vcodes[i])
+            };
+        }
+        for (unsigned i = 0; i < nthreads; i++) {
+            t[i].join();
+        }
+#endif
     }
+
+    mergeVCodeChunks(&vcodes[0], nthreads);
 }
 
 //----------
 template <int keybits, typename hashtype>
 static bool SparseKeyImpl( HashFn hash, const seed_t seed, const unsigned setbits, bool inclusive, flags_t flags ) {
     typedef Blob<keybits> keytype;
-    keytype k(0);
 
     const unsigned keybytes  = keybits / 8;
-    const unsigned totalkeys = inclusive ? 1 + chooseUpToK(keybits, setbits) : chooseK(keybits, setbits);
-
-    std::vector<hashtype> hashes;
-    hashes.reserve(totalkeys);
+    const uint64_t totalkeys = inclusive ? 1 + chooseUpToK(keybits, setbits) : chooseK(keybits, setbits);
+    bool result;
 
-    printf("Keyset 'Sparse' - %d-byte keys with %s %d bits set - %d keys\n",
+    printf("Keyset 'Sparse' - %d-byte keys with %s %d bits set - %" PRIu64 " keys\n",
             keybytes, inclusive ? "up to" : "exactly", setbits, totalkeys);
 
-    if (inclusive) {
-        hashtype h;
-        hash(&k, k.len, seed, &h);
-        addVCodeInput(&k, k.len);
-        hashes.push_back(h);
-    }
+    if (UseHashSpill<hashtype>(totalkeys)) {
+        // The keygen batch takes up to a quarter of the memory budget,
+        // and the two HashSpills split the rest.
+        const uint64_t batchsize = std::max(std::min(std::min(totalkeys, SPARSE_SPILL_BATCH),
+                g_maxMemory / 4 / sizeof(hashtype)), (uint64_t)1);
+        const uint64_t spillmem  = (g_maxMemory - batchsize * sizeof(hashtype)) / 2;
+
+        HashSpill<hashtype>       hashes( spillmem );
+        HashSpill<hashtype>       deltas( spillmem );
+        HashSpillDeltas<hashtype> hashlist( hashes, deltas );
+
+        std::vector<hashtype> batch( batchsize );
+        for (uint64_t n = 0; n < totalkeys; n += batch.size()) {
+            const uint64_t count = std::min(totalkeys - n, (uint64_t)batch.size());
+            SparseKeygen<keytype, hashtype>(hash, seed, setbits, inclusive, n, count, &batch[0]);
+            for (uint64_t i = 0; i < count; i++) {
+                hashlist.push_back(batch[i]);
+            }
+        }
+        std::vector<hashtype>().swap(batch);
+        hashlist.finish();
 
-    SparseKeygenRecurse(hash, seed, 0, setbits, inclusive, k, hashes);
+        result = TestHashList(hashes).reportFlags(flags).testDeltas(deltas).testDistribution(false);
+    } else {
+        std::vector<hashtype> hashes( totalkeys );
 
-    // This loop is very close to the loop in PermutationKeysetTest.cpp, so
-    // the explanatory comments there also apply here, except that a) there
-    // are only two choices for each position, and b) there are a limited
-    // number of allowed 1 bits, while counts of block occurrences in
-    // Permutation are not limited. That is why this loop uses
-    // chooseUpToK() instead of a table, and why it uses the laterbits
-    // variable at all.
-    auto keyprint = [&]( hidx_t n ) {
-        hidx_t t, pos = 0, maxpos = keybits - 1, laterbits = setbits;
-        hashtype v;
+        SparseKeygen<keytype, hashtype>(hash, seed, setbits, inclusive, 0, totalkeys, &hashes[0]);
 
-        k = 0;
-        while (n > 0) {
-            laterbits--;
-            n--;
-            while (n >= (t = 1 + chooseUpToK(maxpos - pos, laterbits))) {
-                n -= t;
-                pos++;
-            }
-            k.flipbit(pos++);
-        }
+        auto keyprint = [&]( hidx_t n ) {
+            SparseKeyIter<keytype> it( setbits, inclusive, n );
+            hashtype v;
 
-        printf("0x%016" PRIx64 "\t", g_seed);
-        k.printbytes(NULL);
-        printf("\t");
-        hash(&k, k.len, seed, &v);
-        v.printhex(NULL);
-    };
+            printf("0x%016" PRIx64 "\t", g_seed);
+            it.key().printbytes(NULL);
+            printf("\t");
+            hash(&it.key(), keytype::len, seed, &v);
+            v.printhex(NULL);
+        };
 
-    bool result = TestHashList(hashes).reportFlags(flags).testDeltas(1).
-        testDistribution(false).dumpFailKeys(keyprint);
+        result = TestHashList(hashes).reportFlags(flags).testDeltas(1).
+            testDistribution(false).dumpFailKeys(keyprint);
+    }
 
     printf("\n");
 
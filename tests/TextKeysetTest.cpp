@@ -67,38 +67,197 @@ static void PrintTextKeyHash( HashFn hash, seed_t seed, const char * key, const
     v.printhex(NULL);
 }
 
+//-----------------------------------------------------------------------------
+// Most of these keysets are built by a keygen function which writes the
+// keys with indices [lo, hi) into a TextKeyArena, which holds a batch of
+// variable-length keys back to back with each key's starting offset. The
+// arena is reused from batch to batch, so there are no per-key
+// allocations, and since any index range can be generated on its own,
+// the keyset is split across g_NCPU threads by HashTextKeys().
+
+class TextKeyArena {
+  public:
+    void clear( void ) {
+        bytes.clear();
+        offsets.assign(1, 0);
+    }
+
+    // Returns where the next len bytes of key data should be written
+    char * add( const uint32_t len ) {
+        const size_t off = offsets.back();
+
+        bytes.resize(off + len);
+        offsets.push_back(off + len);
+        return &bytes[off];
+    }
+
+    size_t count( void ) const { return offsets.size() - 1; }
+
+    const char * key( const size_t i ) const { return &bytes[offsets[i]]; }
+
+    uint32_t len( const size_t i ) const { return (uint32_t)(offsets[i + 1] - offsets[i]); }
+
+  private:
+    std::vector<char>    bytes;
+    std::vector<size_t>  offsets;
+}; // class TextKeyArena
+
+static const uint64_t TEXT_BATCH_KEYS = 4096;
+
+template <typename hashtype, typename keygenfn>
+static void HashTextKeyRange( HashFn hash, const seed_t seed, const keygenfn & keygen, const uint64_t first,
+        const uint64_t last, hashtype * hashes, vcode_chunk_t & vcode ) {
+    TextKeyArena arena;
+
+    for (uint64_t lo = first; lo < last; lo += TEXT_BATCH_KEYS) {
+        const uint64_t hi = std::min(last, lo + TEXT_BATCH_KEYS);
+
+        arena.clear();
+        keygen(arena, lo, hi);
+        assert(arena.count() == (hi - lo));
+
+        for (size_t i = 0; i < arena.count(); i++) {
+            hash(arena.key(i), arena.len(i), seed, &hashes[lo - first + i]);
+            addVCodeInput(vcode, arena.key(i), arena.len(i));
+        }
+    }
+}
+
+template <typename hashtype, typename keygenfn>
+static void HashTextKeys( HashFn hash, const seed_t seed, const keygenfn & keygen, std::vector<hashtype> & hashes ) {
+    const uint64_t keycount = hashes.size();
+    const unsigned nthreads = (keycount >= TEXT_BATCH_KEYS * g_NCPU) ? g_NCPU : 1;
+    std::vector<vcode_chunk_t> vcodes( nthreads );
+
+    if (nthreads == 1) {
+        HashTextKeyRange<hashtype>(hash, seed, keygen, 0, keycount, &hashes[0], vcodes[0]);
+    } else {
+#if defined(HAVE_THREADS)
+        std::vector<std::thread> t( nthreads );
+        for (unsigned i = 0; i < nthreads; i++) {
+            const uint64_t lo = keycount * i / nthreads;
+            const uint64_t hi = keycount * (i + 1) / nthreads;
+            t[i] = std::thread {
+                HashTextKeyRange<hashtype, keygenfn>, hash, seed, std::cref(keygen),
+                lo, hi, &hashes[lo], std::ref(vcodes[i])
+            };
+        }
+        for (unsigned i = 0; i < nthreads; i++) {
+            t[i].join();
+        }
+#endif
+    }
+
+    mergeVCodeChunks(&vcodes[0], nthreads);
+}
+
+template <typename hashtype, typename keygenfn>
+static void PrintTextKey( HashFn hash, const seed_t seed, const keygenfn & keygen, const hidx_t n ) {
+    TextKeyArena arena;
+
+    arena.clear();
+    keygen(arena, n, n + 1);
+    PrintTextKeyHash<hashtype>(hash, seed, arena.key(0), arena.len(0));
+}
+
 //-----------------------------------------------------------------------------
 // Keyset 'Num' - generate all keys from 0 through numcount-1 in string form,
 // either with or without commas.
+//
+// Rather than formatting each number from scratch, a DecimalCounter is set
+// to the first number of each batch, using a table of digit pairs, and is
+// then incremented in place.
+
+class DecimalCounter {
+  public:
+    void set( uint64_t n ) {
+        static const char pairs[] =
+                "00010203040506070809101112131415161718192021222324"
+                "25262728293031323334353637383940414243444546474849"
+                "50515253545556575859606162636465666768697071727374"
+                "75767778798081828384858687888990919293949596979899";
+        unsigned i = MAXDIGITS;
+
+        memset(digits, '0', sizeof(digits));
+        while (n >= 100) {
+            const unsigned p = (n % 100) * 2;
+            n /= 100;
+            digits[--i] = pairs[p + 1];
+            digits[--i] = pairs[p    ];
+        }
+        if (n >= 10) {
+            digits[--i] = pairs[n * 2 + 1];
+            digits[--i] = pairs[n * 2    ];
+        } else {
+            digits[--i] = '0' + n;
+        }
+        first = i;
+    }
+
+    void increment( void ) {
+        unsigned i = MAXDIGITS - 1;
+
+        while (digits[i] == '9') {
+            digits[i--] = '0';
+        }
+        digits[i]++;
+        first = std::min(first, i);
+    }
+
+    template <bool commas>
+    void write( TextKeyArena & arena ) const {
+        const unsigned ndigits = MAXDIGITS - first;
+
+        if (!commas) {
+            memcpy(arena.add(ndigits), &digits[first], ndigits);
+            return;
+        }
+
+        char *   out   = arena.add(ndigits + (ndigits - 1) / 3);
+        unsigned i     = first;
+        unsigned group = (ndigits - 1) % 3 + 1;
+
+        for (;;) {
+            memcpy(out, &digits[i], group);
+            out += group;
+            i   += group;
+            if (i == MAXDIGITS) {
+                break;
+            }
+            *out++ = ',';
+            group  = 3;
+        }
+    }
+
+  private:
+    static const unsigned MAXDIGITS = 20;
+    char      digits[MAXDIGITS];
+    unsigned  first;
+}; // class DecimalCounter
 
 template <typename hashtype, bool commas>
 static bool TextNumImpl( HashFn hash, const seed_t seed, const uint64_t numcount, flags_t flags ) {
-    std::vector<hashtype> hashes(numcount);
-    std::string nstr;
+    std::vector<hashtype> hashes( numcount );
 
     printf("Keyset 'TextNum' - numbers in text form %s commas - %" PRIu64 " keys\n", commas ? "with" : "without", numcount);
 
     //----------
-    auto keybuild = [&]( hidx_t n ) {
-        nstr = std::to_string(n);
-        if (commas) {
-            for (size_t i = nstr.length(); i > 3; i -= 3) {
-                nstr.insert(i - 3, ",");
-            }
+    auto keygen = []( TextKeyArena & arena, uint64_t lo, uint64_t hi ) {
+        DecimalCounter num;
+
+        num.set(lo);
+        for (uint64_t n = lo; n < hi; n++) {
+            num.write<commas>(arena);
+            num.increment();
         }
     };
 
     auto keyprint = [&]( hidx_t n ) {
-        keybuild(n);
-        PrintTextKeyHash<hashtype>(hash, seed, nstr.c_str(), nstr.length());
+        PrintTextKey<hashtype>(hash, seed, keygen, n);
     };
 
     //----------
-    for (uint64_t n = 0; n < numcount; n++) {
-        keybuild(n);
-        hash(nstr.c_str(), nstr.length(), seed, &hashes[n]);
-        addVCodeInput(nstr.c_str(), nstr.length());
-    }
+    HashTextKeys<hashtype>(hash, seed, keygen, hashes);
 
     //----------
     bool result = TestHashList(hashes).reportFlags(flags).dumpFailKeys(keyprint);
@@ -127,7 +286,7 @@ static bool TextKeyImpl( HashFn hash, const seed_t seed, const char * prefix, co
     const unsigned keybytes  = prefixlen + corelen + suffixlen;
     unsigned       keycount  = std::min((uint64_t)pow(double(corecount), double(corelen)), (uint64_t)(INT32_MAX / 8));
 
-    std::vector<hashtype> hashes(keycount);
+    std::vector<hashtype> hashes( keycount );
 
     char * key = new char[keybytes + 1];
     memcpy(key, prefix, prefixlen);
@@ -138,30 +297,45 @@ static bool TextKeyImpl( HashFn hash, const seed_t seed, const char * prefix, co
     printf("Keyset 'Text' - keys of form \"%s\" - %d keys\n", key, keycount);
 
     //----------
-    auto keybuild = [&]( hidx_t n ) {
+    // The core characters of key n are the base-corecount digits of n,
+    // least-significant first. They are set up once per batch, and then
+    // counted upwards like an odometer.
+    auto keygen = [&]( TextKeyArena & arena, uint64_t lo, uint64_t hi ) {
+        VLA_ALLOC(char    , curkey, keybytes);
+        VLA_ALLOC(unsigned, digits, corelen );
+        uint64_t n = lo;
+
+        memcpy(&curkey[0], key, keybytes);
         for (unsigned j = 0; j < corelen; j++) {
-            key[prefixlen + j] = coreset[n % corecount]; n /= corecount;
+            digits[j] = n % corecount; n /= corecount;
+            curkey[prefixlen + j] = coreset[digits[j]];
+        }
+
+        for (n = lo; n < hi; n++) {
+            memcpy(arena.add(keybytes), &curkey[0], keybytes);
+            for (unsigned j = 0; j < corelen; j++) {
+                if (++digits[j] < corecount) {
+                    curkey[prefixlen + j] = coreset[digits[j]];
+                    break;
+                }
+                digits[j] = 0;
+                curkey[prefixlen + j] = coreset[0];
+            }
         }
     };
 
     auto keyprint = [&]( hidx_t n ) {
-        keybuild(n);
-        PrintTextKeyHash<hashtype>(hash, seed, key, keybytes);
+        PrintTextKey<hashtype>(hash, seed, keygen, n);
     };
 
     //----------
-    for (unsigned i = 0; i < keycount; i++) {
-        keybuild(i);
-        hash(key, keybytes, seed, &hashes[i]);
-        addVCodeInput(key, keybytes);
-    }
+    HashTextKeys<hashtype>(hash, seed, keygen, hashes);
 
     //----------
     bool result = TestHashList(hashes).reportFlags(flags).dumpFailKeys(keyprint);
 
     printf("\n");
 
-    memset(key + prefixlen, 'X', corelen);
     recordTestResult(result, "Text", (const char *)key);
 
     addVCodeResult(result);
@@ -206,71 +380,66 @@ static bool WordsKeyImpl( HashFn hash, const seed_t seed, const uint32_t keycoun
         printf("WARNING: skipping %d keys; maxlen and/or coreset parameters are bad\n", remaining);
     }
 
-    std::vector<hashtype> hashes(keycount - remaining);
-    Rand     r( 708218, minlen, maxlen );
-    char *   key = new char[maxlen];
-    uint32_t cnt = 0;
+    std::vector<hashtype> hashes( keycount - remaining );
+    const Rand r( 708218, minlen, maxlen );
 
     printf("Keyset 'Words' - %d-%d random chars from %s charset - %d keys\n",
             minlen, maxlen, name, keycount - remaining);
 
     //----------
-    auto keybuild = [&]( uint64_t itemnum, uint32_t prefixlen, uint32_t len ) {
-        for (unsigned j = 0; j < prefixlen; j++) {
-            key[j] = coreset[itemnum % corecount]; itemnum /= corecount;
-        }
-        for (unsigned j = prefixlen; j < len; j++) {
-            key[j] = coreset[r.rand_range(corecount)];
+    // Keys are generated in order of length, lencount[len] keys per
+    // length. For the first prefixlen characters, convert a random
+    // numeric sequence element into characters from coreset. This
+    // prevents duplicate random words from being generated. If there are
+    // remaining characters, just pick any random ones from coreset.
+    //
+    // Each length uses one RNG value to make its RandSeq, followed by
+    // (len - prefixlen) RNG values per key, so the RNG can be seeked
+    // directly to the start of any key.
+    auto keygen = [&]( TextKeyArena & arena, uint64_t lo, uint64_t hi ) {
+        Rand     rng      = r;
+        uint64_t firstidx = 0, rngpos = 0;
+        std::vector<uint64_t> itemnums;
+
+        for (uint32_t len = minlen; (len <= maxlen) && (lo < hi); len++) {
+            const uint32_t prefixlen = std::min(len, maxprefix);
+            const uint64_t endidx    = firstidx + lencount[len];
+
+            if (lo < endidx) {
+                const uint64_t curcount = pow((double)corecount, (double)prefixlen);
+                const uint64_t n        = lo - firstidx;
+                const uint64_t nkeys    = std::min(hi, endidx) - lo;
+
+                rng.seek(rngpos);
+                RandSeq rs = rng.get_seq(SEQ_NUM, curcount - 1);
+                itemnums.resize(nkeys);
+                rs.write(&itemnums[0], n, nkeys);
+
+                rng.seek(rngpos + n * (len - prefixlen) + 1);
+                for (uint64_t i = 0; i < nkeys; i++) {
+                    char *   key     = arena.add(len);
+                    uint64_t itemnum = itemnums[i];
+                    for (unsigned j = 0; j < prefixlen; j++) {
+                        key[j] = coreset[itemnum % corecount]; itemnum /= corecount;
+                    }
+                    for (unsigned j = prefixlen; j < len; j++) {
+                        key[j] = coreset[rng.rand_range(corecount)];
+                    }
+                }
+                lo += nkeys;
+            }
+
+            firstidx = endidx;
+            rngpos  += (uint64_t)lencount[len] * (len - prefixlen) + 1;
         }
     };
 
     auto keyprint = [&]( hidx_t n ) {
-        // Prepare the state to match the n'th key generation
-        uint32_t len, rngpos = 0, prefixlen = std::min(minlen, maxprefix);
-        uint64_t itemnum;
-
-        for (len = minlen; len <= maxlen; len++) {
-            prefixlen = std::min(len, maxprefix);
-            if (n < lencount[len]) { break; }
-            n        -= lencount[len];
-            rngpos   += lencount[len] * (len - prefixlen) + 1;
-        }
-
-        const uint64_t curcount = pow((double)corecount, (double)prefixlen);
-
-        // Regenerate the RandSeq for this key length
-        r.seek(rngpos);
-        RandSeq rs = r.get_seq(SEQ_NUM, curcount - 1);
-        rs.write(&itemnum, n, 1);
-
-        // Seek the RNG for this specific key
-        r.seek(rngpos + n * (len - prefixlen) + 1);
-
-        // Build the n'th key, and print it out
-        keybuild(itemnum, prefixlen, len);
-        PrintTextKeyHash<hashtype>(hash, seed, key, len);
+        PrintTextKey<hashtype>(hash, seed, keygen, n);
     };
 
     //----------
-    for (uint32_t len = minlen; len <= maxlen; len++) {
-        // Generate lencount[len] keys of this length. For the first
-        // prefixlen characters, convert a random numeric sequence element
-        // into characters from coreset. This prevents duplicate random
-        // words from being generated. If there are remaining characters,
-        // just pick any random ones from coreset.
-        const uint32_t prefixlen = std::min(len, maxprefix);
-        const uint64_t curcount  = pow((double)corecount, (double)prefixlen);
-        RandSeq        rs        = r.get_seq(SEQ_NUM, curcount - 1);
-        uint64_t       itemnum;
-
-        for (uint32_t i = 0; i < lencount[len]; i++) {
-            rs.write(&itemnum, i, 1);
-            keybuild(itemnum, prefixlen, len);
-            hash(key, len, seed, &hashes[cnt++]);
-            addVCodeInput(key, len);
-            //fprintf(stderr, "%ld\t%d:%ld\t%.*s\n", i, len, nnn, len, key);
-        }
-    }
+    HashTextKeys<hashtype>(hash, seed, keygen, hashes);
 
     //----------
     bool result = TestHashList(hashes).reportFlags(flags).dumpFailKeys(keyprint);
@@ -284,7 +453,6 @@ static bool WordsKeyImpl( HashFn hash, const seed_t seed, const uint32_t keycoun
     addVCodeResult(result);
 
     delete [] lencount;
-    delete [] key;
 
     return result;
 }
@@ -351,7 +519,7 @@ static bool WordsLongImpl( HashFn hash, const seed_t seed, const long keycount,
     };
 
     //----------
-    for (hidx_t i = 0; i < keycount; i++) {
+    for (hidx_t i = 0; i < (hidx_t)keycount; i++) {
         keybuild(i);
 
         for (size_t offset = 0; offset < varylen; offset++) {
@@ -390,7 +558,7 @@ static bool WordsLongImpl( HashFn hash, const seed_t seed, const long keycount,
 
 template <typename hashtype>
 static bool WordsDictImpl( HashFn hash, const seed_t seed, flags_t flags ) {
-    std::vector<std::string> words = GetWordlist(CASE_LOWER_UPPER, REPORT(VERBOSE, flags));
+    const Wordlist words = GetWordlist(CASE_LOWER_UPPER, REPORT(VERBOSE, flags));
     const size_t wordscount = words.size();
 
     printf("Keyset 'Dict' - dictionary words - %zd keys\n", wordscount);
@@ -399,15 +567,14 @@ static bool WordsDictImpl( HashFn hash, const seed_t seed, flags_t flags ) {
     hashes.resize(wordscount);
 
     for (size_t i = 0; i < wordscount; i++) {
-        const unsigned len = words[i].length();
-        const char *   key = words[i].c_str();
-        hash(key, len, seed, &hashes[i]);
-        addVCodeInput(key, len);
+        const wordlist_word_t word = words[i];
+        hash(word.ptr, word.len, seed, &hashes[i]);
+        addVCodeInput(word.ptr, word.len);
     }
 
     //----------
     bool result = TestHashList(hashes).reportFlags(flags).dumpFailKeys([&](hidx_t i) {
-            PrintTextKeyHash<hashtype>(hash, seed, words[i].c_str(), words[i].length());
+            PrintTextKeyHash<hashtype>(hash, seed, words[i].ptr, words[i].len);
         });
     printf("\n");
 
@@ -126,7 +126,8 @@ static bool TwoBytesTestLen( HashFn hash, const seed_t seed, size_t keylen, flag
 
     TwoBytesLenKeygen(hash, seed, keylen, hashes);
 
-    auto keyprint = [&]( hidx_t i ) {
+    auto keyprint = [&]( hidx_t n ) {
+        uint32_t i = n;
         VLA_ALLOC(uint8_t, key, keylen);
         memset(&key[0], 0, keylen);
 
@@ -229,9 +230,9 @@ static bool TwoBytesTestUpToLen( HashFn hash, const seed_t seed, size_t maxlen,
 
     TwoBytesUpToLenKeygen(hash, seed, maxlen, hashes);
 
-    auto keyprint = [&]( hidx_t i ) {
+    auto keyprint = [&]( hidx_t n ) {
         const uint32_t keylencnt = Sum1toN(maxlen) - 1;
-        uint32_t keylen;
+        uint32_t i = n, keylen;
         VLA_ALLOC(uint8_t, key, maxlen);
         memset(&key[0], 0, maxlen);
 
@@ -82,7 +82,7 @@ static bool ZeroKeyImpl( HashFn hash, const seed_t seed, flags_t flags ) {
     auto keyprint = [&]( hidx_t i ) {
         hashtype v;
         hash(nullblock, i, seed, &v);
-        printf("0x%016" PRIx64 "\t%d copies of 0x00\t", g_seed, i);
+        printf("0x%016" PRIx64 "\t%" PRIu64 " copies of 0x00\t", g_seed, (uint64_t)i);
         v.printhex(NULL);
     };
 
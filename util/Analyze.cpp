@@ -54,11 +54,16 @@
 #include "Platform.h"
 #include "TestGlobals.h"
 #include "Blobsort.h"
+#include "VCode.h"
+#include "HashSpill.h"
 #include "Stats.h"
 #include "Reporting.h"
 #include "Analyze.h"
 #include "Instantiate.h"
-#include "VCode.h"
+
+#if defined(HAVE_AVX512_BW)
+  #include "Intrinsics.h"
+#endif
 
 #include <cstring> // for memset
 #include <math.h>
@@ -149,6 +154,77 @@ static void FindCollBitBounds( std::set<int> & nbBitsvec, int origBits, uint64_t
     }
 }
 
+//----------------------------------------------------------------------------
+// Compute the bit widths to test for partial collisions. Each width in
+// nbBitsvec is reported on explicitly, and widths in [minTBits, maxTBits]
+// are reported on as a summary. Collision counts need to be computed for
+// widths in [minBits, maxBits], with threshBits set as described in
+// FindCollBitBounds().
+static void FindCollBitRanges( const uint64_t nbH, const int hashbits, const bool testMaxColl,
+        const bool willTestDist, std::set<int, std::greater<int>> & nbBitsvec, int & minBits,
+        int & maxBits, int & threshBits, int & minTBits, int & maxTBits ) {
+    nbBitsvec.insert({ 224, 160, 128, 64, 32 });
+    // cyan: The 12- and -8-bit tests are too small : tables are necessarily saturated.
+    // It would be better to count the nb of collisions per Cell, and
+    // compared the distribution of values against a random source.
+    // But that would be a different test.
+    //
+    // rurban: No, these tests are for non-prime hash tables, using only
+    //     the lower 5-10 bits
+    //
+    // fwojcik: Collision counting did not previously reflect
+    // rurban's comment, as the code counted the sum of collisions
+    // across _all_ buckets. So if there are many more hashes than
+    // 2**nbBits, and the hash is even _slightly_ not broken, then
+    // every n-bit truncated hash value will appear at least once, in
+    // which case the "actual" value reported would always be
+    // (hashes.size() - 2**nbBits). Checking the results in doc/
+    // confirms this. cyan's comment was correct.
+    //
+    // Collision counting has now been modified to report on the
+    // single bucket with the most collisions when fuller hash tables
+    // are being tested, and ReportCollisions() computes an
+    // appropriate "expected" statistic.
+    if (testMaxColl) {
+        nbBitsvec.insert({ 12, 8 });
+    }
+
+    // Compute the number of bits for a collision count of about 100
+    const int hundredCollBits = FindMaxBitsTargetCollisions(nbH, 100, hashbits);
+    if (EstimateNbCollisions(nbH, hundredCollBits) >= 100) {
+        nbBitsvec.insert(hundredCollBits);
+    }
+
+    // Each bit width value in nbBitsvec is explicitly reported on. If
+    // any of those values are less than the n*log(n) bound, then the
+    // bin with the most collisions will be reported on, otherwise the
+    // total sum of collisions across all bins will be reported on.
+    //
+    // There are also many more bit widths that a) are probably used in
+    // the real world, and b) we can now cheaply analyze and report
+    // on. Any bit width above the n*log(n) bound that has a reasonable
+    // number of expected collisions is worth analyzing, so that range
+    // of widths is computed here.
+    //
+    // This is slightly complicated by the fact that TestDistribution() may
+    // also get invoked, which does an RMSE-based comparison to the
+    // expected distribution over some range of bit width values. If that
+    // will be invoked, then there's no point in doubly-reporting on
+    // collision counts for those bit widths, so they get excluded here.
+    const int nlognBits = GetNLogNBound(nbH);
+    minTBits = willTestDist ? std::max(MaxDistBits(nbH) + 1, nlognBits) : nlognBits;
+    maxTBits = FindMaxBitsTargetCollisions(nbH, 10, hashbits - 1);
+
+    // Given the range of hash sizes we care about, compute all
+    // collision counts for them, for high- and low-bits as requested.
+    std::set<int> combinedBitsvec;
+    combinedBitsvec.insert(nbBitsvec.begin(), nbBitsvec.end());
+    for (int i = minTBits; i <= maxTBits; i++) {
+        combinedBitsvec.insert(i);
+    }
+    FindCollBitBounds(combinedBitsvec, hashbits, nbH, minBits, maxBits, threshBits);
+}
+
 //-----------------------------------------------------------------------------
 // Sort the hash list, count the total number of collisions and return the
 // first N collisions for further processing. If requested, also count the
@@ -213,7 +289,7 @@ hidx_t FindCollisionsImpl( std::vector<hashtype> & hashes, std::map<hashtype, ui
 
 template <typename hashtype>
 hidx_t FindCollisions( std::vector<hashtype> & hashes, std::map<hashtype, uint32_t> & collisions, hidx_t maxCollisions ) {
-    std::vector<uint32_t> dummy;
+    std::vector<hidx_t> dummy;
     return FindCollisionsImpl<hashtype, false>(hashes, collisions, maxCollisions, 0, dummy, dummy);
 }
 
@@ -235,12 +311,18 @@ INSTANTIATE(FindCollisionsIndices, HASHTYPELIST);
 // first prevPrefixLen bits, for the case where they were reported on
 // previously.
 //
+// If lowbits is true, then collisions in the last prefixLen bits are
+// looked for instead, and the hashes are visited in the order given by
+// lowidxs, as computed by SortLowBitsOrder(). The colliding bits are
+// recorded bit-reversed, as PrintCollisions() expects.
+//
 // This is just different enough from FindCollisions() to fully
 // re-implement here, instead of diving further into template madness.
-template <typename hashtype>
-static hidx_t FindCollisionsPrefixesIndices( std::vector<hashtype> & hashes, std::map<hashtype, uint32_t> & collisions,
-        hidx_t maxCollisions, uint32_t maxPerCollision, std::vector<hidx_t> & collisionidxs,
-        const std::vector<hidx_t> & hashidxs, uint32_t prefixLen, uint32_t prevPrefixLen ) {
+template <bool lowbits, typename hashtype>
+static hidx_t FindCollisionsPrefixesIndices( const std::vector<hashtype> & hashes, const std::vector<hidx_t> & lowidxs,
+        std::map<hashtype, uint32_t> & collisions, hidx_t maxCollisions, uint32_t maxPerCollision,
+        std::vector<hidx_t> & collisionidxs, const std::vector<hidx_t> & hashidxs, uint32_t prefixLen,
+        uint32_t prevPrefixLen ) {
     hidx_t collcount = 0, curcollcount = 0;
     hashtype mask;
 
@@ -252,27 +334,34 @@ static hidx_t FindCollisionsPrefixesIndices( std::vector<hashtype> & hashes, std
 
     const size_t nbH = hashes.size();
     for (size_t hnb = 1; hnb < nbH; hnb++) {
+        const hidx_t prev = lowbits ? lowidxs[hnb - 1] : hnb - 1;
+        const hidx_t cur  = lowbits ? lowidxs[hnb]     : hnb;
+
         // Search until we find a collision in the first [prefixLen, prevPrefixLen) bits
-        hashtype hdiff = hashes[hnb - 1] ^ hashes[hnb];
-        uint32_t hzb   = hdiff.highzerobits();
+        hashtype hdiff = hashes[prev] ^ hashes[cur];
+        uint32_t hzb   = lowbits ? hdiff.lowzerobits() : hdiff.highzerobits();
         if ((hzb < prefixLen) || (hzb >= prevPrefixLen)) {
             continue;
         }
 
         collcount++;
 
-        hashtype colliding_bits = hashes[hnb] & mask;
+        hashtype colliding_bits = hashes[cur];
+        if (lowbits) {
+            colliding_bits.reversebits();
+        }
+        colliding_bits = colliding_bits & mask;
         auto it = collisions.find(colliding_bits);
         if (it != collisions.end()) {
             it->second++;
             if (curcollcount < maxPerCollision) {
-                collisionidxs.push_back(hashidxs[hnb]);
+                collisionidxs.push_back(hashidxs[cur]);
                 curcollcount++;
             }
         } else if ((hidx_t)collisions.size() < maxCollisions) {
             collisions.emplace(std::pair<hashtype, uint32_t>{colliding_bits, 2});
-            collisionidxs.push_back(hashidxs[hnb - 1]);
-            collisionidxs.push_back(hashidxs[hnb]);
+            collisionidxs.push_back(hashidxs[prev]);
+            collisionidxs.push_back(hashidxs[cur]);
             curcollcount = 2;
         }
     }
@@ -296,96 +385,236 @@ static hidx_t FindCollisionsPrefixesIndices( std::vector<hashtype> & hashes, std
 // counting the number of bits which match the next-lower hash value,
 // since a collision for N bits is also a collision for N-k bits.
 //
-// This requires the vector of hashes to be sorted.
-template <bool calcmax, typename hashtype>
-static void CountRangedNbCollisionsImpl( std::vector<hashtype> & hashes,
-        int minHBits, int maxHBits, int threshHBits, int * collcounts ) {
+// This requires the hashes to be visited in sorted order. matchbits(i)
+// must return the number of matching bits between the (i-1)th and ith
+// hashes in that order.
+//
+// The hashes are processed in blocks. The match lengths for a block are
+// computed and clamped to [minHBits - 1, maxHBits] first, and then they
+// are tallied into a histogram. Since neighboring sorted hashes usually
+// have the same match length, the histogram is split into several
+// copies, so that back-to-back increments of the same counter don't
+// serialize on store-to-load forwarding. The peak collision count for a
+// bit width is the longest run of consecutive hashes which collide in
+// that many bits, so the current run length is tracked for all widths at
+// once, in a fixed-size array which the compiler can vectorize.
+static const size_t COLL_BLOCK   = 512;
+static const int    COLL_COPIES  = 4;
+static const int    COLL_MAXRUNS = 64;
+
+template <bool calcmax, typename F, typename counttype>
+static void CountRangedNbCollisionsImpl( const uint64_t nbH, F matchbits,
+        int minHBits, int maxHBits, int threshHBits, counttype * collcounts ) {
     assert(minHBits >= 1       );
     assert(minHBits <= maxHBits);
-    assert(hashtype::bitlen >= (size_t)maxHBits);
     assert(!calcmax || (threshHBits >= minHBits));
     assert(!calcmax || (threshHBits <= maxHBits));
 
     const int collbins    = maxHBits - minHBits + 1;
     const int maxcollbins = calcmax ? threshHBits - minHBits + 1 : 0;
-    VLA_ALLOC(int, prevcoll, maxcollbins + 1);
-    VLA_ALLOC(int, maxcoll, maxcollbins + 1);
-
-    memset(collcounts, 0, sizeof(collcounts[0]) * collbins );
-    if (calcmax) {
-        memset(&prevcoll[0], 0, sizeof(prevcoll[0]) * maxcollbins);
-        memset(&maxcoll[0],  0, sizeof(maxcoll[0])  * maxcollbins);
-    }
+    const int histbins    = collbins + 1;
+    assert(histbins <= 256);
+    assert(maxcollbins <= COLL_MAXRUNS);
+
+    // Histogram entry 0 counts hashes with no collision in minHBits bits,
+    // and entry i counts collisions in exactly (minHBits - 1 + i) bits, or
+    // more for the last entry.
+    std::vector<uint64_t> hist( COLL_COPIES * histbins, 0 );
+    uint32_t runlen[COLL_MAXRUNS] = { 0 };
+    uint32_t maxrun[COLL_MAXRUNS] = { 0 };
+    uint8_t  lens[COLL_BLOCK];
+
+    for (uint64_t base = 1; base < nbH; base += COLL_BLOCK) {
+        const size_t count = (size_t)std::min((uint64_t)COLL_BLOCK, nbH - base);
+
+        for (size_t j = 0; j < count; j++) {
+            const int hzb = std::min(std::max(matchbits(base + j), minHBits - 1), maxHBits);
+            lens[j] = (uint8_t)(hzb - (minHBits - 1));
+        }
 
-    const uint64_t nbH = hashes.size();
-    for (uint64_t hnb = 1; hnb < nbH; hnb++) {
-        hashtype hdiff = hashes[hnb - 1] ^ hashes[hnb];
-        int      hzb   = hdiff.highzerobits();
-        if (hzb >= minHBits) {
-            if (hzb > maxHBits) {
-                hzb = maxHBits;
+        size_t j = 0;
+        for (; j + COLL_COPIES <= count; j += COLL_COPIES) {
+            for (int c = 0; c < COLL_COPIES; c++) {
+                hist[c * histbins + lens[j + c]]++;
             }
-            collcounts[hzb - minHBits]++;
         }
-        // If we don't care about maximum collision counts, or if this
-        // hash is a collision for *all* bit widths where we do care about
-        // maximums, then this is all that need be done for this hash.
-        if (!calcmax) {
-            continue;
+        for (; j < count; j++) {
+            hist[lens[j]]++;
         }
-        if (hzb >= threshHBits) {
+
+        if (!calcmax) {
             continue;
         }
-        // If we do care about maximum collision counts, then any window
-        // sizes which are strictly larger than hzb have just encountered
-        // a non-collision. For each of those window sizes, see how many
-        // collisions there have been since the last non-collision, and
-        // record it if that's the new peak.
-        if (hzb < minHBits - 1) {
-            hzb = minHBits - 1;
-        }
-        // coll is the total number of collisions so far, for the window
-        // width corresponding to index i
-        int coll = 0;
-        for (int i = collbins - 1; i >= maxcollbins; i--) {
-            coll += collcounts[i];
+        // A run of collisions for width index i continues as long as the
+        // match length covers that width, and ends otherwise.
+        for (j = 0; j < count; j++) {
+            const uint32_t len = lens[j];
+            for (int i = 0; i < COLL_MAXRUNS; i++) {
+                const uint32_t r = ((uint32_t)i < len) ? runlen[i] + 1 : 0;
+                runlen[i] = r;
+                maxrun[i] = std::max(maxrun[i], r);
+            }
         }
-        for (int i = maxcollbins - 1; i > hzb - minHBits; i--) {
-            coll += collcounts[i];
-            // See if this is the new peak for this window width
-            maxcoll[i] = std::max(maxcoll[i], coll - prevcoll[i]);
-            // Record the total number of collisions seen so far at this
-            // non-collision, so that when the next non-collision happens we
-            // can compute how many collisions there have been since this one.
-            prevcoll[i] = coll;
+    }
+
+    // A collision in N bits is a collision in every smaller width, so the
+    // counts are summed from the widest width downwards.
+    uint64_t coll = 0;
+    for (int i = collbins - 1; i >= 0; i--) {
+        for (int c = 0; c < COLL_COPIES; c++) {
+            coll += hist[c * histbins + i + 1];
         }
+        collcounts[i] = (counttype)coll;
+    }
+    for (int i = 0; i < maxcollbins; i++) {
+        collcounts[i] = (counttype)maxrun[i];
+    }
+}
+
+template <typename F, typename counttype>
+static void CountRangedNbCollisionsBy( const uint64_t nbH, F matchbits,
+        int minHBits, int maxHBits, int threshHBits, counttype * collcounts ) {
+    if (threshHBits == 0) {
+        return CountRangedNbCollisionsImpl<false>(nbH, matchbits, minHBits, maxHBits, 0, collcounts);
+    } else {
+        return CountRangedNbCollisionsImpl<true>(nbH, matchbits, minHBits, maxHBits, threshHBits, collcounts);
+    }
+}
+
+// Partial collision counts are kept as 64-bit values, since they can
+// exceed 2^31 when hidx_t is 64 bits, but they are always added to the
+// VCode as 32-bit values so that the VCode doesn't depend on that.
+static void addVCodeCollCounts( const std::vector<uint64_t> & counts ) {
+    if (counts.size() == 0) {
+        return;
     }
+    std::vector<uint32_t> vcounts( counts.begin(), counts.end() );
+    addVCodeResult(&vcounts[0], sizeof(vcounts[0]) * vcounts.size());
+}
+
+template <typename hashtype>
+static void CountRangedNbCollisions( const std::vector<hashtype> & hashes, int minHBits,
+        int maxHBits, int threshHBits, uint64_t * collcounts ) {
+    assert(hashtype::bitlen >= (size_t)maxHBits);
 
-    for (int i = collbins - 2; i >= 0; i--) {
-        collcounts[i] += collcounts[i + 1];
+    auto matchbits = [&]( uint64_t hnb ) {
+        hashtype hdiff = hashes[hnb - 1] ^ hashes[hnb];
+        return (int)hdiff.highzerobits();
+    };
+
+    CountRangedNbCollisionsBy(hashes.size(), matchbits, minHBits, maxHBits, threshHBits, collcounts);
+}
+
+// This is the same as CountRangedNbCollisions(), except that it considers
+// only the low bits of each hash, visiting them in the order given by
+// lowidxs.
+template <typename hashtype>
+static void CountRangedNbLowCollisions( const std::vector<hashtype> & hashes, const std::vector<hidx_t> & lowidxs,
+        int minHBits, int maxHBits, int threshHBits, uint64_t * collcounts ) {
+    assert(hashtype::bitlen >= (size_t)maxHBits);
+
+    auto matchbits = [&]( uint64_t hnb ) {
+        hashtype hdiff = hashes[lowidxs[hnb - 1]] ^ hashes[lowidxs[hnb]];
+        return (int)hdiff.lowzerobits();
+    };
+
+    CountRangedNbCollisionsBy(hashes.size(), matchbits, minHBits, maxHBits, threshHBits, collcounts);
+}
+
+// Compute the order the hashes would be in if they were sorted with all
+// their bits reversed, as a list of indices into hashes[], without making
+// a reversed copy of them. Only the reversed low keybits bits of each hash
+// are radix-sorted, and any runs of hashes which match in all of those
+// bits are then put in order by comparing their remaining bits directly.
+// Such runs are rare as long as keybits is at least the widest partial
+// collision width being counted, except for very bad hashes.
+template <unsigned keybits, typename hashtype>
+static void SortLowBitsOrderBy( const std::vector<hashtype> & hashes, std::vector<hidx_t> & lowidxs ) {
+    typedef Blob<(hashtype::bitlen > keybits) ? keybits : hashtype::bitlen> keytype;
+    const hidx_t nbH = hashes.size();
+
+    std::vector<keytype> keys( nbH );
+    for (hidx_t hnb = 0; hnb < nbH; hnb++) {
+        keys[hnb] = keytype(&hashes[hnb], sizeof(keytype));
+        keys[hnb].reversebits();
+    }
+
+    lowidxs.clear();
+    blobsort(keys.begin(), keys.end(), lowidxs);
+
+    if (hashtype::bitlen <= keytype::bitlen) {
+        return;
     }
-    if (calcmax) {
-        for (int i = maxcollbins - 1; i >= 0; i--) {
-            collcounts[i] = std::max(maxcoll[i], collcounts[i] - prevcoll[i]);
+
+    auto lowbitsless = [&]( hidx_t a, hidx_t b ) {
+        hashtype ha = hashes[a], hb = hashes[b];
+        ha.reversebits();
+        hb.reversebits();
+        return ha < hb;
+    };
+
+    hidx_t start = 0;
+    for (hidx_t hnb = 1; hnb <= nbH; hnb++) {
+        if ((hnb < nbH) && (keys[hnb] == keys[start])) {
+            continue;
+        }
+        if ((hnb - start) > 1) {
+            std::stable_sort(lowidxs.begin() + start, lowidxs.begin() + hnb, lowbitsless);
         }
+        start = hnb;
     }
 }
 
+// Partial collisions are counted in at most maxBits bits, so if that
+// is no more than 32, then 32-bit sort keys are enough to keep runs of
+// matching keys short. This halves the size of the keys for hashes of
+// 64 bits or more.
 template <typename hashtype>
-static void CountRangedNbCollisions( std::vector<hashtype> & hashes, int minHBits,
-        int maxHBits, int threshHBits, int * collcounts ) {
-    if (threshHBits == 0) {
-        return CountRangedNbCollisionsImpl<false>(hashes, minHBits, maxHBits, 0, collcounts);
+static void SortLowBitsOrder( const std::vector<hashtype> & hashes, std::vector<hidx_t> & lowidxs, int maxBits ) {
+    if (maxBits <= 32) {
+        SortLowBitsOrderBy<32>(hashes, lowidxs);
     } else {
-        return CountRangedNbCollisionsImpl<true>(hashes, minHBits, maxHBits, threshHBits, collcounts);
+        SortLowBitsOrderBy<64>(hashes, lowidxs);
     }
 }
 
 //----------------------------------------------------------------------------
 
+// What a clear pass from the --screen sketches leaves for the exact tests
+// to do; see ScreenHashList(). The total collision counts for widths in
+// [minBits, maxBits] were counted exactly by the sketches, so they are not
+// counted or reported on again, and if dist is set then the distribution
+// test was sampled well enough to not need the full scan.
+//
+// Any pair of hashes which collide in more than maxBits high bits also
+// collide in their high maxBits bits, so highcands holds every hash which
+// shares its high maxBits bits with another one, and it is enough to
+// count collisions in every wider width, including the full hash width.
+// lowcands is the same for the low bits, with their bits already reversed.
+// These are usually a small fraction of the whole list. They are empty if
+// they weren't collected, which is the case if failing keys are to be
+// reported, since that needs the whole list.
+template <typename hashtype>
+struct ScreenPass {
+    int  minBits;
+    int  maxBits;
+    bool dist;
+    bool cands;
+    std::vector<hashtype> highcands;
+    std::vector<hashtype> lowcands;
+
+    ScreenPass() : minBits( 0 ), maxBits( 0 ), dist( false ), cands( false ) {}
+};
+
+// If screened is not NULL, then the list has passed the --screen
+// sketches, and only the partial collision widths they didn't cover are
+// counted and reported on. If screened has candidate lists and only
+// widths wider than the sketches remain, only those lists are sorted and
+// counted, instead of the whole list.
 template <typename hashtype>
 static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t> & hashidxs, int * logpSumPtr,
-        KeyFn keyprint, int testDeltaNum, flags_t testFlags, flags_t reportFlags ) {
+        KeyFn keyprint, int testDeltaNum, flags_t testFlags, flags_t reportFlags,
+        ScreenPass<hashtype> * screened = NULL ) {
     const unsigned hashbits   = hashtype::bitlen;
     const hidx_t   nbH        = hashes.size();
     const bool testDeltaXaxis = TEST(DELTAXAXIS,    testFlags);
@@ -403,156 +632,111 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
 
     addVCodeOutput(&hashes[0], hashtype::len * nbH);
 
-    // Note that FindCollisions sorts the list of hashes!
-    std::map<hashtype, uint32_t> collisions;
-    std::vector<hidx_t>          collisionidxs;
-    hidx_t                       collcount;
-    if (REPORT(DIAGRAMS, reportFlags)) {
-        collcount = FindCollisionsIndices(hashes, collisions, MAX_ENTRIES, MAX_PER_ENTRY, collisionidxs, hashidxs);
-    } else {
-        collcount = FindCollisions(hashes, collisions, 0);
-    }
-    addVCodeResult(collcount);
-
     // If analysis of partial collisions is requested, figure out which bit
-    // widths make sense to test, and then test them.
-    std::vector<hidx_t>              hashidxs_rev;
-    std::vector<hashtype>            hashes_rev;
+    // widths make sense to test.
+    std::vector<hidx_t>              lowidxs;
     std::set<int, std::greater<int>> nbBitsvec;
-    std::vector<int>                 collcounts_fwd;
-    std::vector<int>                 collcounts_rev;
+    std::vector<uint64_t>            collcounts_fwd;
+    std::vector<uint64_t>            collcounts_rev;
     int minBits = 0, maxBits = 0, threshBits = 0, minTBits = 0, maxTBits = 0;
 
     if (testHighBits || testLowBits) {
-        nbBitsvec.insert({ 224, 160, 128, 64, 32 });
-        // cyan: The 12- and -8-bit tests are too small : tables are necessarily saturated.
-        // It would be better to count the nb of collisions per Cell, and
-        // compared the distribution of values against a random source.
-        // But that would be a different test.
-        //
-        // rurban: No, these tests are for non-prime hash tables, using only
-        //     the lower 5-10 bits
-        //
-        // fwojcik: Collision counting did not previously reflect
-        // rurban's comment, as the code counted the sum of collisions
-        // across _all_ buckets. So if there are many more hashes than
-        // 2**nbBits, and the hash is even _slightly_ not broken, then
-        // every n-bit truncated hash value will appear at least once, in
-        // which case the "actual" value reported would always be
-        // (hashes.size() - 2**nbBits). Checking the results in doc/
-        // confirms this. cyan's comment was correct.
-        //
-        // Collision counting has now been modified to report on the
-        // single bucket with the most collisions when fuller hash tables
-        // are being tested, and ReportCollisions() computes an
-        // appropriate "expected" statistic.
-        if (testMaxColl) {
-            nbBitsvec.insert({ 12, 8 });
-        }
+        FindCollBitRanges(nbH, hashbits, testMaxColl, willTestDist, nbBitsvec,
+                minBits, maxBits, threshBits, minTBits, maxTBits);
+
+        if (screened != NULL) {
+            for (auto it = nbBitsvec.begin(); it != nbBitsvec.end();) {
+                const bool maxcoll = testMaxColl && (*it <= threshBits);
+                if (!maxcoll && (*it >= screened->minBits) && (*it <= screened->maxBits)) {
+                    it = nbBitsvec.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (minTBits >= screened->minBits) {
+                minTBits = std::max(minTBits, screened->maxBits + 1);
+            }
 
-        // Compute the number of bits for a collision count of about 100
-        const int hundredCollBits = FindMaxBitsTargetCollisions(nbH, 100, hashbits);
-        if (EstimateNbCollisions(nbH, hundredCollBits) >= 100) {
-            nbBitsvec.insert(hundredCollBits);
+            std::set<int> combinedBitsvec( nbBitsvec.begin(), nbBitsvec.end() );
+            for (int i = minTBits; i <= maxTBits; i++) {
+                combinedBitsvec.insert(i);
+            }
+            FindCollBitBounds(combinedBitsvec, hashbits, nbH, minBits, maxBits, threshBits);
         }
+    }
 
-        // Each bit width value in nbBitsvec is explicitly reported on. If
-        // any of those values are less than the n*log(n) bound, then the
-        // bin with the most collisions will be reported on, otherwise the
-        // total sum of collisions across all bins will be reported on.
-        //
-        // There are also many more bit widths that a) are probably used in
-        // the real world, and b) we can now cheaply analyze and report
-        // on. Any bit width above the n*log(n) bound that has a reasonable
-        // number of expected collisions is worth analyzing, so that range
-        // of widths is computed here.
-        //
-        // This is slightly complicated by the fact that TestDistribution() may
-        // also get invoked, which does an RMSE-based comparison to the
-        // expected distribution over some range of bit width values. If that
-        // will be invoked, then there's no point in doubly-reporting on
-        // collision counts for those bit widths, so they get excluded here.
-        const int nlognBits = GetNLogNBound(nbH);
-        minTBits = willTestDist ? std::max(MaxDistBits(nbH) + 1, nlognBits) : nlognBits;
-        maxTBits = FindMaxBitsTargetCollisions(nbH, 10, hashbits - 1);
-
-        // Given the range of hash sizes we care about, compute all
-        // collision counts for them, for high- and low-bits as requested.
-        std::set<int> combinedBitsvec;
-        combinedBitsvec.insert(nbBitsvec.begin(), nbBitsvec.end());
-        for (int i = minTBits; i <= maxTBits; i++) {
-            combinedBitsvec.insert(i);
-        }
-        FindCollBitBounds(combinedBitsvec, hashbits, nbH, minBits, maxBits, threshBits);
+    // If every width left to count is wider than the ones the --screen
+    // sketches covered, then only their candidate hashes need to be sorted.
+    const bool useCands = (screened != NULL) && screened->cands && (threshBits == 0) &&
+            ((maxBits == 0) || (minBits > screened->maxBits));
+    std::vector<hashtype> & highhashes = useCands ? screened->highcands : hashes;
 
+    // Note that FindCollisions sorts the list of hashes!
+    std::map<hashtype, uint32_t> collisions;
+    std::vector<hidx_t>          collisionidxs;
+    hidx_t                       collcount = 0;
+    if (REPORT(DIAGRAMS, reportFlags)) {
+        collcount = FindCollisionsIndices(hashes, collisions, MAX_ENTRIES, MAX_PER_ENTRY, collisionidxs, hashidxs);
+    } else if (highhashes.size() > 0) {
+        collcount = FindCollisions(highhashes, collisions, 0);
+    }
+    addVCodeResult(collcount);
+
+    if (testHighBits || testLowBits) {
         // This is the actual testing; the counting of partial collisions
         if (testHighBits && (maxBits > 0)) {
             collcounts_fwd.resize(maxBits - minBits + 1);
-            CountRangedNbCollisions(hashes, minBits, maxBits, threshBits, &collcounts_fwd[0]);
-            if (collcounts_fwd.size() != 0) {
-                addVCodeResult(&collcounts_fwd[0], sizeof(collcounts_fwd[0]) *
-                        collcounts_fwd.size());
-            }
+            CountRangedNbCollisions(highhashes, minBits, maxBits, threshBits, &collcounts_fwd[0]);
+            addVCodeCollCounts(collcounts_fwd);
         }
 
-        // For testing low bits, reverse all the hash values and test them
-        // as if they were high bits, modulo bit numbers.
+        // For testing low bits, the hashes need to be visited in the
+        // order they would have if their bits were reversed.
         //
         // If reporting on failing hashes wasn't requested, then the
-        // original hashes and their indices aren't needed any longer, so
-        // just reuse the original memory. Otherwise, copy the data before
-        // manipulating it. The *_rev versions of the variables make it
-        // clear what data is being used.
+        // current ordering of the hashes isn't needed any longer, so just
+        // reverse them in place, sort them, and test them as if they were
+        // high bits. Otherwise, the high-bits ordering is needed for
+        // reporting, so compute a list of indices in low-bits order
+        // instead, and leave the hashes alone. The --screen candidates
+        // for the low bits were already reversed, so they are just sorted.
         if (testLowBits && (maxBits > 0)) {
             collcounts_rev.resize(maxBits - minBits + 1);
 
-            if (REPORT(DIAGRAMS, reportFlags)) {
-                hashes_rev.resize(nbH);
-                for (size_t hnb = 0; hnb < nbH; hnb++) {
-                    hashes_rev[hnb] = hashes[hnb];
-                    hashes_rev[hnb].reversebits();
+            if (useCands) {
+                std::vector<hashtype> & lowhashes = screened->lowcands;
+                if (lowhashes.size() > 0) {
+                    blobsort(lowhashes.begin(), lowhashes.end());
                 }
-                hashidxs_rev = hashidxs;
-
-                blobsort(hashes_rev.begin(), hashes_rev.end(), hashidxs_rev);
+                CountRangedNbCollisions(lowhashes, minBits, maxBits, threshBits, &collcounts_rev[0]);
+            } else if (REPORT(DIAGRAMS, reportFlags)) {
+                SortLowBitsOrder(hashes, lowidxs, maxBits);
+                CountRangedNbLowCollisions(hashes, lowidxs, minBits, maxBits, threshBits, &collcounts_rev[0]);
             } else {
-                hashes_rev   = std::move(hashes);
-                hashidxs_rev = std::move(hashidxs);
-                hashes.clear();
-                hashidxs.clear();
                 for (size_t hnb = 0; hnb < nbH; hnb++) {
-                    hashes_rev[hnb].reversebits();
+                    hashes[hnb].reversebits();
                 }
+                blobsort(hashes.begin(), hashes.end());
 
-                blobsort(hashes_rev.begin(), hashes_rev.end());
-            }
-
-            CountRangedNbCollisions(hashes_rev, minBits, maxBits, threshBits, &collcounts_rev[0]);
+                CountRangedNbCollisions(hashes, minBits, maxBits, threshBits, &collcounts_rev[0]);
 
-            if (collcounts_rev.size() != 0) {
-                addVCodeResult(&collcounts_rev[0], sizeof(collcounts_rev[0]) *
-                        collcounts_rev.size());
-            }
-
-            // The data is restored to original bit ordering for other
-            // reporting beyond TestCollisions(). There is no need to
-            // re-sort it, though, since TestDistribution doesn't care.
-            if (!REPORT(DIAGRAMS, reportFlags)) {
+                // The data is restored to original bit ordering for other
+                // reporting beyond TestCollisions(). There is no need to
+                // re-sort it, though, since TestDistribution doesn't care.
                 for (size_t hnb = 0; hnb < nbH; hnb++) {
-                    hashes_rev[hnb].reversebits();
+                    hashes[hnb].reversebits();
                 }
-                hashes   = std::move(hashes_rev);
-                hashidxs = std::move(hashidxs_rev);
-                hashes_rev.clear();
-                hashidxs_rev.clear();
             }
+
+            addVCodeCollCounts(collcounts_rev);
         }
     }
 
     // Report on complete collisions, now that the heavy lifting is complete
     bool result = true;
     int  curlogp;
-    result &= ReportCollisions(nbH, collcount, hashbits, &curlogp, false, false, false, reportFlags);
+    result &= ReportCollisions(nbH, collcount, hashbits,
+            &curlogp, false, false, false, reportFlags);
     if (logpSumPtr != NULL) {
         *logpSumPtr += curlogp;
     }
@@ -578,8 +762,8 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
                     *logpSumPtr += curlogp;
                 }
                 if (!thisresult && REPORT(DIAGRAMS, reportFlags)) {
-                    FindCollisionsPrefixesIndices(hashes, collisions, MAX_ENTRIES, MAX_PER_ENTRY,
-                            collisionidxs, hashidxs, nbBits, prevBitsH);
+                    FindCollisionsPrefixesIndices<false>(hashes, lowidxs, collisions, MAX_ENTRIES,
+                            MAX_PER_ENTRY, collisionidxs, hashidxs, nbBits, prevBitsH);
                     PrintCollisions(collisions, MAX_ENTRIES, MAX_PER_ENTRY, collisionidxs, keyprint,
                             testDeltaNum, testDeltaXaxis, nbH, nbBits, prevBitsH, false);
                     prevBitsH = nbBits;
@@ -593,8 +777,8 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
                     *logpSumPtr += curlogp;
                 }
                 if (!thisresult && REPORT(DIAGRAMS, reportFlags)) {
-                    FindCollisionsPrefixesIndices(hashes_rev, collisions, MAX_ENTRIES, MAX_PER_ENTRY,
-                            collisionidxs, hashidxs_rev, nbBits, prevBitsL);
+                    FindCollisionsPrefixesIndices<true>(hashes, lowidxs, collisions, MAX_ENTRIES,
+                            MAX_PER_ENTRY, collisionidxs, hashidxs, nbBits, prevBitsL);
                     PrintCollisions(collisions, MAX_ENTRIES, MAX_PER_ENTRY, collisionidxs, keyprint,
                             testDeltaNum, testDeltaXaxis, nbH, nbBits, prevBitsL, true);
                     prevBitsL = nbBits;
@@ -604,7 +788,7 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
         }
 
         // Report a summary of the bit widths in the range [minTBits, maxTBits]
-        if (testHighBits) {
+        if (testHighBits && (minTBits <= maxTBits)) {
             int maxBits;
             bool thisresult = ReportBitsCollisions(nbH, &collcounts_fwd[minTBits - minBits],
                     minTBits, maxTBits, &curlogp, &maxBits, true, reportFlags);
@@ -612,14 +796,14 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
                 *logpSumPtr += curlogp;
             }
             if (!thisresult && REPORT(DIAGRAMS, reportFlags)) {
-                FindCollisionsPrefixesIndices(hashes, collisions, MAX_ENTRIES, MAX_PER_ENTRY,
-                        collisionidxs, hashidxs, maxBits, hashbits + 1);
+                FindCollisionsPrefixesIndices<false>(hashes, lowidxs, collisions, MAX_ENTRIES,
+                        MAX_PER_ENTRY, collisionidxs, hashidxs, maxBits, hashbits + 1);
                 PrintCollisions(collisions, MAX_ENTRIES, MAX_PER_ENTRY, collisionidxs, keyprint,
                         testDeltaNum, testDeltaXaxis, nbH, maxBits, maxBits, false);
             }
             result &= thisresult;
         }
-        if (testLowBits) {
+        if (testLowBits && (minTBits <= maxTBits)) {
             int maxBits;
             bool thisresult = ReportBitsCollisions(nbH, &collcounts_rev[minTBits - minBits],
                     minTBits, maxTBits, &curlogp, &maxBits, false, reportFlags);
@@ -627,8 +811,8 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
                 *logpSumPtr += curlogp;
             }
             if (!thisresult && REPORT(DIAGRAMS, reportFlags)) {
-                FindCollisionsPrefixesIndices(hashes_rev, collisions, MAX_ENTRIES, MAX_PER_ENTRY,
-                        collisionidxs, hashidxs_rev, maxBits, hashbits + 1);
+                FindCollisionsPrefixesIndices<true>(hashes, lowidxs, collisions, MAX_ENTRIES,
+                        MAX_PER_ENTRY, collisionidxs, hashidxs, maxBits, hashbits + 1);
                 PrintCollisions(collisions, MAX_ENTRIES, MAX_PER_ENTRY, collisionidxs, keyprint,
                         testDeltaNum, testDeltaXaxis, nbH, maxBits, maxBits, true);
             }
@@ -639,20 +823,157 @@ static bool TestCollisions( std::vector<hashtype> & hashes, std::vector<hidx_t>
     return result;
 }
 
+//----------------------------------------------------------------------------
+// Helpers for TestDistributionBatch(), which keeps bin counts in the
+// narrowest of 8-, 16-, or 32-bit bins that can hold them.
+
+// Count the given N-bit slice of every hash into the bins. Returns false if
+// any bin overflowed, in which case the counts are incomplete.
+template <typename bintype, typename hashtype>
+static bool CountDistBins( const hashtype * hashes, const size_t nbH, int start, int width, bintype * bins ) {
+    memset(bins, 0, sizeof(bintype) << width);
+    for (size_t j = 0; j < nbH; j++) {
+        prefetch(&hashes[j + 4]);
+        uint32_t index = hashes[j].window(start, width);
+
+        if (unlikely(++bins[index] == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fold the bins in half. Returns true if any sum overflowed. We can't
+// easily just stop the loop when it happens, because some number of items
+// have already been folded. I did try stopping this loop when overflow is
+// detected, undoing just that addition, and then copying the first i
+// non-overflowed items into wider bins followed by summing the rest into
+// them as "normal", but that ended up being slightly slower than this!
+template <typename bintype>
+static bool FoldDistBins( bintype * bins, const size_t bincount ) {
+    bool overflow = false;
+
+    // To allow the compiler to vectorize this loop
+    assume((bincount % 64) == 0);
+    for (size_t i = 0; i < bincount; i++) {
+        bintype b = bins[i + bincount];
+        bintype a = bins[i] += b;
+        overflow |= a < b;
+    }
+    return overflow;
+}
+
+#if defined(HAVE_AVX512_BW)
+
+static bool FoldDistBins( uint8_t * bins, const size_t bincount ) {
+    __mmask64 overflow = 0;
+
+    for (size_t i = 0; i < bincount; i += 64) {
+        __m512i b = _mm512_loadu_si512((const void *)&bins[i + bincount]);
+        __m512i a = _mm512_loadu_si512((const void *)&bins[i]);
+        a = _mm512_add_epi8(a, b);
+        _mm512_storeu_si512((void *)&bins[i], a);
+        overflow |= _mm512_cmplt_epu8_mask(a, b);
+    }
+    return overflow != 0;
+}
+
+static bool FoldDistBins( uint16_t * bins, const size_t bincount ) {
+    __mmask32 overflow = 0;
+
+    for (size_t i = 0; i < bincount; i += 32) {
+        __m512i b = _mm512_loadu_si512((const void *)&bins[i + bincount]);
+        __m512i a = _mm512_loadu_si512((const void *)&bins[i]);
+        a = _mm512_add_epi16(a, b);
+        _mm512_storeu_si512((void *)&bins[i], a);
+        overflow |= _mm512_cmplt_epu16_mask(a, b);
+    }
+    return overflow != 0;
+}
+
+#endif
+
+// After FoldDistBins() overflowed, redo the fold into wider bins. This
+// construction undoes the (possibly overflowed) addition.
+template <typename bintype, typename widetype>
+static void WidenFoldedDistBins( const bintype * bins, widetype * widebins, const size_t bincount ) {
+    for (size_t i = 0; i < bincount; i++) {
+        bintype b = bins[i + bincount];
+        bintype a = bins[i] - b;
+        widebins[i] = (widetype)a + (widetype)b;
+    }
+}
+
 //----------------------------------------------------------------------------
 // Measures how well the hashes are distributed across all hash bins, for
 // each possible N-bit slice of the hash values, with N going from 8 to
 // MaxDistBits(nbH) (which is 24 or less) inclusive.
 
+// Score the distribution of the slices of the hashes starting at the given
+// bit, for each width from maxwidth down to minwidth, storing the scores
+// in that order. The bins8 vector must have room for (1 << maxwidth)
+// entries; the others are resized as needed.
+template <typename hashtype>
+static void TestDistributionAtBit( const hashtype * hashes, const size_t nbH, int start, int maxwidth,
+        int minwidth, std::vector<uint8_t> & bins8, std::vector<uint16_t> & bins16,
+        std::vector<uint32_t> & bins32, double * resultptr ) {
+    int    width    = maxwidth;
+    size_t bincount = (1 << width);
+    int    binbytes = 1;          // Are we using 8-, 16-, or 32-bit bins?
+
+    if (unlikely(!CountDistBins(hashes, nbH, start, width, &bins8[0]))) {
+        // Primary overflow, during initial counting.
+        // printf("TestDistribution: Overflow %zu into %u: bit %d\n", nbH, bincount, start);
+        bins16.resize(bincount);
+        binbytes = 2;
+        if (unlikely(!CountDistBins(hashes, nbH, start, width, &bins16[0]))) {
+            bins32.resize(bincount);
+            binbytes = 4;
+            CountDistBins(hashes, nbH, start, width, &bins32[0]);
+        }
+    }
+
+    // Test the distribution, then fold the bins in half, and
+    // repeat until we're down to 256 (== 1 << minwidth) bins.
+    while (true) {
+        uint64_t sumsq = (binbytes == 1) ? sumSquares(&bins8[0], bincount)  :
+                         (binbytes == 2) ? sumSquares(&bins16[0], bincount) :
+                                           sumSquares(&bins32[0], bincount);
+        *resultptr++ = calcScore(sumsq, bincount, nbH);
+
+        width--;
+        bincount /= 2;
+
+        if (width < minwidth) { break; }
+
+        if (binbytes == 1) {
+            if (unlikely(FoldDistBins(&bins8[0], bincount))) {
+                // Secondary overflow, during folding
+                bins16.resize(bincount);
+                WidenFoldedDistBins(&bins8[0], &bins16[0], bincount);
+                binbytes = 2;
+            }
+        } else if (binbytes == 2) {
+            if (unlikely(FoldDistBins(&bins16[0], bincount))) {
+                bins32.resize(bincount);
+                WidenFoldedDistBins(&bins16[0], &bins32[0], bincount);
+                binbytes = 4;
+            }
+        } else {
+            FoldDistBins(&bins32[0], bincount);
+        }
+    }
+}
+
 template <typename hashtype>
-static void TestDistributionBatch( const std::vector<hashtype> & hashes, a_int & ikeybit, int batch_size,
+static void TestDistributionBatch( const hashtype * hashes, const size_t nbH, a_int & ikeybit, int batch_size,
         int maxwidth, int minwidth, int * tests, double * result_scores ) {
-    const size_t   nbH       = hashes.size();
     const int      hashbits  = sizeof(hashtype) * 8;
     int            testcount = 0;
     int            startbit;
 
-    std::vector<uint8_t> bins8(1 << maxwidth);
+    std::vector<uint8_t>  bins8(1 << maxwidth);
+    std::vector<uint16_t> bins16;
     std::vector<uint32_t> bins32;
 
     // To calculate the distributions of hash value slices, this loop does
@@ -666,116 +987,41 @@ static void TestDistributionBatch( const std::vector<hashtype> & hashes, a_int &
     // where possible. The problem is, if the hash is bad, we might
     // overflow a bin.
     //
-    // For now, when it happens that any count overflows 8 bits we go
-    // straight to 32 bits. We could add a 16-bit bin code path, but it's
-    // not clear it'd be worth the complexity.
+    // When that happens, the counting is redone with 16-bit bins, which
+    // is enough for all but very bad hashes, and only if those overflow
+    // too do we go to 32-bit bins. The same widening is done if a bin
+    // overflows while folding.
+    //
+    // Keeping several interleaved copies of the bins, to avoid
+    // store-to-load forwarding stalls on repeated indices, was tried. At
+    // 5..10 hashes per bin repeats are rare enough that the extra cache
+    // footprint and merging cost made it slower at every width.
     while ((startbit = FETCH_ADD(ikeybit, batch_size)) < hashbits) {
         const int stopbit = std::min(startbit + batch_size, hashbits);
 
         for (int start = startbit; start < stopbit; start++) {
-            int    width    = maxwidth;
-            size_t bincount = (1 << width);
-            bool   bigbins  = false;          // Are we using 32-bit bins?
-
-            memset(&bins8[0], 0, bincount * sizeof(bins8[0]));
-            for (size_t j = 0; j < nbH; j++) {
-                prefetch(&hashes[j + 4]);
-                uint32_t index = hashes[j].window(start, width);
-
-                if (unlikely(++bins8[index] == 0)) {
-                    bigbins = true;
-                    break;
-                }
-            }
-            if (unlikely(bigbins)) {
-                // Primary overflow, during initial counting.
-                // XXX Maybe If we got far enough (j large enough), copy counts
-                // and continue 8-bit loop?
-                // printf("TestDistribution: Overflow %zu into %u: bit %d/%d\n", nbH, bincount, start, hashbits);
-                bins32.clear();
-                bins32.resize(bincount);
-                for (size_t j = 0; j < nbH; j++) {
-                    uint32_t index = hashes[j].window(start, width);
-                    ++bins32[index];
-                }
-            }
-
-            // Test the distribution, then fold the bins in half, and
-            // repeat until we're down to 256 (== 1 << minwidth) bins.
-            double * resultptr = &result_scores[start * (maxwidth - minwidth + 1)];
-            while (true) {
-                uint64_t sumsq = bigbins ? sumSquares(&bins32[0], bincount) :
-                    sumSquares(&bins8[0], bincount);
-                *resultptr++ = calcScore(sumsq, bincount, nbH);
-
-                testcount++;
-                width--;
-                bincount /= 2;
-
-                if (width < minwidth) { break; }
-
-                // To allow the compiler to vectorize these loops
-                assume((bincount % 64) == 0);
-                if (bigbins) {
-                    // Fold 32-bit bins in half
-                    for (size_t i = 0; i < bincount; i++) {
-                        bins32[i] += bins32[i + bincount];
-                    }
-                } else {
-                    // Fold 8-bit bins in half and detect unsigned overflow. We
-                    // can't easily just stop the loop when it happens, because
-                    // some number of items have already been folded. I did try
-                    // stopping this loop when overflow is detected, undoing
-                    // just that addition, and then copying the first i
-                    // non-overflowed items from bins8[] into bins32[] followed
-                    // by summing the rest into bins32[] as "normal", but that
-                    // ended up being slightly slower than this!
-                    for (size_t i = 0; i < bincount; i++) {
-                        uint8_t b = bins8[i + bincount];
-                        uint8_t a = bins8[i] += b;
-                        bigbins |= a < b;
-                    }
-                    if (bigbins) {
-                        // Secondary overflow, during folding
-                        bins32.resize(bincount);
-                        for (size_t i = 0; i < bincount; i++) {
-                            // This construction undoes the (possibly
-                            // overflowed) addition in the previous loop.
-                            uint8_t b = bins8[i + bincount];
-                            uint8_t a = bins8[i] - b;
-                            bins32[i] = (uint32_t)a + (uint32_t)b;
-                        }
-                    }
-                }
-            }
+            TestDistributionAtBit(hashes, nbH, start, maxwidth, minwidth, bins8, bins16, bins32,
+                    &result_scores[start * (maxwidth - minwidth + 1)]);
+            testcount += maxwidth - minwidth + 1;
         }
     }
 
     *tests = testcount;
 }
 
+// Fill in scores[] for every bit offset and width, returning the number
+// of tests done.
 template <typename hashtype>
-static bool TestDistribution( std::vector<hashtype> & hashes, std::vector<hidx_t> & hashidxs, int * logpSumPtr,
-        KeyFn keyprint, unsigned testDeltaNum, flags_t testFlags, flags_t reportFlags ) {
-    const int      hashbits  = hashtype::bitlen;
-    const size_t   nbH       = hashes.size();
-    int            maxwidth  = MaxDistBits(nbH);
-    int            minwidth  = 8;
-
-    if (maxwidth < minwidth) {
-        return true;
-    }
-
-    if (!REPORT(QUIET, reportFlags)) {
-        printf("Testing distribution   (any  %2i..%2i bits) - ", minwidth, maxwidth);
-    }
+static int TestDistributionScores( const hashtype * hashes, const size_t nbH, int maxwidth, int minwidth,
+        std::vector<double> & scores ) {
+    const int hashbits = hashtype::bitlen;
+    a_int     istartbit( 0 );
+    int       tests;
 
-    std::vector<double> scores(hashbits * (maxwidth - minwidth + 1));
-    a_int istartbit( 0 );
-    int tests;
+    scores.resize(hashbits * (maxwidth - minwidth + 1));
 
-    if (g_NCPU == 1) {
-        TestDistributionBatch<hashtype>(hashes, istartbit, hashbits,
+    if ((g_NCPU == 1) || g_inParallel) {
+        TestDistributionBatch<hashtype>(hashes, nbH, istartbit, hashbits,
                 maxwidth, minwidth, &tests, &scores[0]);
     } else {
 #if defined(HAVE_THREADS)
@@ -783,7 +1029,7 @@ static bool TestDistribution( std::vector<hashtype> & hashes, std::vector<hidx_t
         std::vector<int> ttests(g_NCPU);
         for (unsigned i = 0; i < g_NCPU; i++) {
             t[i] = std::thread {
-                TestDistributionBatch<hashtype>, std::ref(hashes), std::ref(istartbit),
+                TestDistributionBatch<hashtype>, hashes, nbH, std::ref(istartbit),
                 hashbits/16, maxwidth, minwidth, &ttests[i], &scores[0]
             };
         }
@@ -795,6 +1041,28 @@ static bool TestDistribution( std::vector<hashtype> & hashes, std::vector<hidx_t
 #endif
     }
 
+    return tests;
+}
+
+template <typename hashtype>
+static bool TestDistribution( std::vector<hashtype> & hashes, std::vector<hidx_t> & hashidxs, int * logpSumPtr,
+        KeyFn keyprint, unsigned testDeltaNum, flags_t testFlags, flags_t reportFlags ) {
+    const int      hashbits  = hashtype::bitlen;
+    const size_t   nbH       = hashes.size();
+    int            maxwidth  = MaxDistBits(nbH);
+    int            minwidth  = 8;
+
+    if (maxwidth < minwidth) {
+        return true;
+    }
+
+    if (!REPORT(QUIET, reportFlags)) {
+        printf("Testing distribution   (any  %2i..%2i bits) - ", minwidth, maxwidth);
+    }
+
+    std::vector<double> scores;
+    int tests = TestDistributionScores(&hashes[0], nbH, maxwidth, minwidth, scores);
+
     int curlogp, bitstart, bitwidth;
     bool result = ReportDistribution(scores, tests, hashbits, maxwidth, minwidth,
             &curlogp, &bitstart, &bitwidth, reportFlags);
@@ -810,6 +1078,329 @@ static bool TestDistribution( std::vector<hashtype> & hashes, std::vector<hidx_t
     return result;
 }
 
+//-----------------------------------------------------------------------------
+// A quick approximate screen of a list of hashes, for --screen mode.
+//
+// Instead of sorting the list and scanning every distribution window, this
+// makes a few streaming passes over it to compute some cheap sketches:
+//
+// - Collisions in the high and low N bits, where N is a few bits more than
+//   log2(nbH), and in a range of widths below that, counted exactly using a
+//   bitmap of every N-bit value.
+// - The number of distinct full-width hash values, estimated using a
+//   HyperLogLog sketch, which catches very broken hashes whose flaws
+//   don't show up in those N bits.
+// - The distribution test, for only a sample of the possible start bits.
+//
+// The worst of their p-values decides if the list clearly passes, clearly
+// fails, or is borderline enough to need the exact tests to decide.
+//
+// A clear failure skips the exact tests, unless failing keys are to be
+// reported, which needs them. A clear pass skips the distribution test
+// for every start bit, and the total collision counts for widths the
+// bitmaps covered. Full-width collisions, the wider partial collision
+// widths (such as 32, 64, and 128 bits), and max-collision buckets are
+// still tested exactly, but if only widths wider than the bitmaps are
+// left, then only the hashes which collide in the bitmaps' widest window
+// are sorted to count them; see ScreenPass.
+static const uint64_t SCREEN_MIN_HASHES   = 1 << 16;
+static const int      SCREEN_PASS_LOG2P   = 8;
+static const int      SCREEN_FAIL_LOG2P   = 40;
+static const int      SCREEN_EXTRA_BITS   = 4;
+static const int      SCREEN_MAX_BITS     = 28;
+static const int      SCREEN_FOLD_BITS    = 12;
+static const int      SCREEN_HLL_BITS     = 14;
+static const int      SCREEN_DIST_STARTS  = 8;
+static const size_t   SCREEN_BLOCK        = 1024;
+static const size_t   SCREEN_PREFETCH     = 16;
+
+enum ScreenResult {
+    SCREEN_PASS,
+    SCREEN_FAIL,
+    SCREEN_BORDERLINE,
+};
+
+// Mix all the bits of a hash value into 64 well-distributed bits, since
+// the HyperLogLog sketch needs random-looking inputs, and the hashes being
+// screened might be anything but.
+template <typename hashtype>
+static uint64_t ScreenMix( const hashtype & hash ) {
+    uint64_t x = 0;
+
+    for (size_t i = 0; i < hashtype::len; i += 4) {
+        uint32_t w;
+        memcpy(&w, &hash[i], 4);
+        x  = (x ^ w) * UINT64_C(0x9E3779B97F4A7C15);
+        x ^= x >> 29;
+    }
+    // fmix64() from MurmurHash3
+    x ^= x >> 33;
+    x *= UINT64_C(0xff51afd7ed558ccd);
+    x ^= x >> 33;
+    x *= UINT64_C(0xc4ceb9fe1a85ec53);
+    x ^= x >> 33;
+    return x;
+}
+
+// The number of collisions at each width is nbH minus the number of
+// distinct values, which is the popcount of the bitmap. Folding the bitmap
+// in half gives the bitmap for 1 fewer bits, so every narrower width down
+// to minBits is nearly free. The high bits are reversed first, so that
+// folding drops their lowest bit instead of their highest.
+//
+// If highcands is not NULL, then a second bitmap records which nbBits-bit
+// values were seen more than once. Its words are interleaved with the
+// first bitmap's, so that updating both only touches one cache line. Then
+// every hash with one of those values
+// is added to highcands for the high bits, or to lowcands with its bits
+// reversed for the low bits, as described in ScreenPass. If nbBits ==
+// hashbits, the one window covers every bit, so it goes into highcands.
+template <typename hashtype>
+static double ScreenCollisions( const std::vector<hashtype> & hashes, int nbBits, int minBits, int * logpp,
+        std::vector<hashtype> * highcands, std::vector<hashtype> * lowcands ) {
+    const int      hashbits = hashtype::bitlen;
+    const uint64_t nbH      = hashes.size();
+    const size_t   words    = (UINT64_C(1) << nbBits) / 64;
+    const size_t   stride   = (highcands != NULL) ? 2 : 1;
+    std::vector<uint64_t> bitmap( words * stride );
+    double worstp = 1.0;
+
+    if (highcands != NULL) {
+        highcands->clear();
+        lowcands->clear();
+    }
+
+    // The bitmaps are often too big for the caches, so the hashes are
+    // visited in blocks, computing each block's nbBits-bit values first, so
+    // that the bitmap words they need can be prefetched well ahead of time.
+    // The values past the end of a short block are stale, but still valid
+    // bitmap indices, so prefetching them is harmless.
+    uint32_t vals[SCREEN_BLOCK + SCREEN_PREFETCH] = { 0 };
+
+    // With nbBits == hashbits, the high and low bits are the same bits.
+    const int windows = (nbBits < hashbits) ? 2 : 1;
+    for (int i = 0; i < windows; i++) {
+        auto windowvals = [&]( uint64_t base, size_t count ) {
+            for (size_t j = 0; j < count; j++) {
+                hashtype h = hashes[base + j];
+                if (i != 0) {
+                    h.reversebits();
+                }
+                vals[j] = h.window(0, nbBits);
+            }
+        };
+
+        std::fill(bitmap.begin(), bitmap.end(), 0);
+        for (uint64_t base = 0; base < nbH; base += SCREEN_BLOCK) {
+            const size_t count = (size_t)std::min((uint64_t)SCREEN_BLOCK, nbH - base);
+            windowvals(base, count);
+            for (size_t j = 0; j < count; j++) {
+                prefetch(&bitmap[(vals[j + SCREEN_PREFETCH] >> 6) * stride]);
+                const uint32_t v   = vals[j];
+                const uint64_t bit = UINT64_C(1) << (v & 63);
+                uint64_t *     w   = &bitmap[(v >> 6) * stride];
+                if (highcands != NULL) {
+                    w[1] |= w[0] & bit;
+                }
+                w[0] |= bit;
+            }
+        }
+
+        if (highcands != NULL) {
+            const bool highbits = (i == 1) || (windows == 1);
+            for (uint64_t base = 0; base < nbH; base += SCREEN_BLOCK) {
+                const size_t count = (size_t)std::min((uint64_t)SCREEN_BLOCK, nbH - base);
+                windowvals(base, count);
+                for (size_t j = 0; j < count; j++) {
+                    prefetch(&bitmap[(vals[j + SCREEN_PREFETCH] >> 6) * 2]);
+                    const uint32_t v = vals[j];
+                    if (bitmap[(v >> 6) * 2 + 1] & (UINT64_C(1) << (v & 63))) {
+                        if (highbits) {
+                            highcands->push_back(hashes[base + j]);
+                        } else {
+                            hashtype h = hashes[base + j];
+                            h.reversebits();
+                            lowcands->push_back(h);
+                        }
+                    }
+                }
+            }
+
+            // Gather the first bitmap's words for folding
+            for (size_t j = 0; j < words; j++) {
+                bitmap[j] = bitmap[j * 2];
+            }
+        }
+
+        for (int b = nbBits; b >= minBits; b--) {
+            const size_t bwords   = (UINT64_C(1) << b) / 64;
+            uint64_t     distinct = 0;
+            for (size_t j = 0; j < bwords; j++) {
+                distinct += popcount8(bitmap[j]);
+            }
+            const double expected = EstimateNbCollisions(nbH, b);
+            worstp = std::min(worstp, GetBoundedPoissonPValue(expected, nbH - distinct));
+            for (size_t j = 0; j < bwords / 2; j++) {
+                bitmap[j] |= bitmap[j + bwords / 2];
+            }
+        }
+    }
+
+    worstp = ScalePValue(worstp, windows * (nbBits - minBits + 1));
+    *logpp = GetLog2PValue(worstp);
+    return worstp;
+}
+
+template <typename hashtype>
+static double ScreenDistinct( const std::vector<hashtype> & hashes, int * logpp ) {
+    const uint64_t nbH = hashes.size();
+    const double   m   = (double)(1 << SCREEN_HLL_BITS);
+    std::vector<uint8_t> regs( 1 << SCREEN_HLL_BITS, 0 );
+
+    for (uint64_t hnb = 0; hnb < nbH; hnb++) {
+        const uint64_t x    = ScreenMix(hashes[hnb]);
+        const uint64_t idx  = x >> (64 - SCREEN_HLL_BITS);
+        const uint64_t rest = (x << SCREEN_HLL_BITS) | (UINT64_C(1) << (SCREEN_HLL_BITS - 1));
+        const uint8_t  rank = (uint8_t)(clz8(rest) + 1);
+        regs[idx] = std::max(regs[idx], rank);
+    }
+
+    double sum   = 0.0;
+    int    zeros = 0;
+    for (const uint8_t r: regs) {
+        sum   += ldexp(1.0, -(int)r);
+        zeros += (r == 0) ? 1 : 0;
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if ((estimate <= 2.5 * m) && (zeros > 0)) {
+        estimate = m * log(m / zeros);
+    }
+
+    // Only a shortfall of distinct values is a failure. The relative
+    // standard error of the estimate is 1.04/sqrt(m).
+    const double expected = (double)nbH - EstimateNbCollisions(nbH, hashtype::bitlen);
+    const double stderror = expected * 1.04 / sqrt(m);
+    const double p_value  = GetStdNormalPValue((expected - estimate) / stderror);
+
+    *logpp = GetLog2PValue(p_value);
+    return p_value;
+}
+
+template <typename hashtype>
+static double ScreenDistribution( const std::vector<hashtype> & hashes, int * logpp ) {
+    const int    hashbits = hashtype::bitlen;
+    const size_t nbH      = hashes.size();
+    const int    maxwidth = MaxDistBits(nbH);
+    const int    minwidth = 8;
+    const int    nwidths  = maxwidth - minwidth + 1;
+
+    std::vector<uint8_t>  bins8(1 << maxwidth);
+    std::vector<uint16_t> bins16;
+    std::vector<uint32_t> bins32;
+    std::vector<double>   scores(SCREEN_DIST_STARTS * nwidths);
+
+    for (int i = 0; i < SCREEN_DIST_STARTS; i++) {
+        TestDistributionAtBit(&hashes[0], nbH, i * hashbits / SCREEN_DIST_STARTS, maxwidth, minwidth,
+                bins8, bins16, bins32, &scores[i * nwidths]);
+    }
+
+    const double worstN  = std::max(0.0, *std::max_element(scores.begin(), scores.end()));
+    const double p_value = ScalePValue(GetStdNormalPValue(worstN), scores.size());
+
+    *logpp = GetLog2PValue(p_value);
+    return p_value;
+}
+
+template <typename hashtype>
+static ScreenResult ScreenHashList( const std::vector<hashtype> & hashes, int * logpSumPtr,
+        flags_t testFlags, flags_t reportFlags, ScreenPass<hashtype> & screened ) {
+    const int      hashbits = hashtype::bitlen;
+    const uint64_t nbH      = hashes.size();
+    const bool     testColl = TEST(COLLISIONS,   testFlags);
+    const bool     testDist = TEST(DISTRIBUTION, testFlags) && (MaxDistBits(nbH) >= 8);
+
+    // Small lists are cheap enough to just test exactly. So are the
+    // collisions of 32-bit hashes, which sort about as fast as the bitmaps
+    // can be filled, so without a distribution test for the screen to
+    // replace, it would only add to their cost.
+    if ((nbH < SCREEN_MIN_HASHES) || (!testColl && !testDist) || (!testDist && (hashbits <= 32))) {
+        return SCREEN_BORDERLINE;
+    }
+
+    const int nbBits  = std::min(std::min(hashbits, SCREEN_MAX_BITS),
+            (int)floor(log2((double)nbH)) + SCREEN_EXTRA_BITS);
+    const int minBits = std::max(8, nbBits - SCREEN_FOLD_BITS);
+    int    logp_coll = 0, logp_distinct = 0, logp_dist = 0;
+    double p_value   = 1.0;
+    int    sketches  = 0;
+
+    // Collecting the candidates for a clear pass costs one more pass over
+    // the hashes, but saves sorting all of them afterwards. Reporting
+    // failing keys needs the whole sorted list anyway.
+    const bool cands = !REPORT(DIAGRAMS, reportFlags);
+
+    if (testColl) {
+        p_value   = std::min(p_value, ScreenCollisions(hashes, nbBits, minBits, &logp_coll,
+                cands ? &screened.highcands : NULL, cands ? &screened.lowcands : NULL));
+        p_value   = std::min(p_value, ScreenDistinct(hashes, &logp_distinct));
+        sketches += 2;
+    }
+    if (testDist) {
+        p_value   = std::min(p_value, ScreenDistribution(hashes, &logp_dist));
+        sketches += 1;
+    }
+    p_value = ScalePValue(p_value, sketches);
+
+    const int    logp   = GetLog2PValue(p_value);
+    ScreenResult screen = (logp < SCREEN_PASS_LOG2P)  ? SCREEN_PASS :
+                          (logp >= SCREEN_FAIL_LOG2P) ? SCREEN_FAIL : SCREEN_BORDERLINE;
+    const bool   dumpfail = (screen == SCREEN_FAIL) && REPORT(DIAGRAMS, reportFlags);
+
+    if (!REPORT(QUIET, reportFlags)) {
+        printf("Screening hashes  (%2i..%2i-bit sketches) - %s ", minBits, nbBits,
+                (screen == SCREEN_PASS) ? "clear pass, running other tests    " :
+                dumpfail                ? "clear failure, finding failing keys" :
+                (screen == SCREEN_FAIL) ? "clear failure, skipping exact tests" :
+                                          "borderline, running exact tests    ");
+        if (REPORT(MORESTATS, reportFlags)) {
+            printf("(coll ^%2d, distinct ^%2d, dist ^%2d) ", logp_coll, logp_distinct, logp_dist);
+        }
+        if ((screen == SCREEN_BORDERLINE) || dumpfail) {
+            printf("(^%2d)\n", logp);
+        }
+    }
+
+    // The exact tests decide the result, so that they report failing keys.
+    if (dumpfail) {
+        return SCREEN_BORDERLINE;
+    }
+    if (screen == SCREEN_PASS) {
+        if (testColl) {
+            screened.minBits = minBits;
+            screened.maxBits = nbBits;
+            screened.cands   = cands;
+        }
+        screened.dist = testDist;
+    } else {
+        screened.highcands.clear();
+        screened.highcands.shrink_to_fit();
+        screened.lowcands.clear();
+        screened.lowcands.shrink_to_fit();
+    }
+
+    if (screen != SCREEN_BORDERLINE) {
+        int curlogp;
+        addVCodeOutput(&hashes[0], hashtype::len * nbH);
+        ReportPValue(p_value, &curlogp, reportFlags);
+        addVCodeResult(curlogp);
+        if (logpSumPtr != NULL) {
+            *logpSumPtr += curlogp;
+        }
+    }
+
+    return screen;
+}
+
 //-----------------------------------------------------------------------------
 // Compute a number of statistical tests on a list of hashes, comparing
 // them to a list of i.i.d. random numbers across a large range of bit
@@ -818,14 +1409,25 @@ static bool TestDistribution( std::vector<hashtype> & hashes, std::vector<hidx_t
 template <typename hashtype>
 static bool TestHashListSingle( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn keyprint,
         unsigned testDeltaNum, flags_t testFlags, flags_t reportFlags ) {
-    std::vector<hidx_t> hashidxs;
+    std::vector<hidx_t>  hashidxs;
+    ScreenPass<hashtype> screened;
+    ScreenResult         screen = SCREEN_BORDERLINE;
     bool result = true;
 
+    if (g_screenHashes) {
+        screen = ScreenHashList(hashes, logpSumPtr, testFlags, reportFlags, screened);
+        if (screen == SCREEN_FAIL) {
+            return false;
+        }
+    }
+    const bool passed = (screen == SCREEN_PASS);
+
     if (TEST(COLLISIONS, testFlags)) {
-        result &= TestCollisions(hashes, hashidxs, logpSumPtr, keyprint, testDeltaNum, testFlags, reportFlags);
+        result &= TestCollisions(hashes, hashidxs, logpSumPtr, keyprint, testDeltaNum, testFlags, reportFlags,
+                passed ? &screened : NULL);
     }
 
-    if (TEST(DISTRIBUTION, testFlags)) {
+    if (TEST(DISTRIBUTION, testFlags) && !(passed && screened.dist)) {
         result &= TestDistribution(hashes, hashidxs, logpSumPtr, keyprint, testDeltaNum, testFlags, reportFlags);
     }
 
@@ -862,12 +1464,18 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
     // is sorted below inside TestHashListSingle(). The calls to test the
     // list(s) of deltas come at the bottom of this function.
     //
+    // To avoid needing memory for three full lists of hashes at once, the
+    // y-axis deltas are not computed here. Instead, the first hash of each
+    // row is saved, which is enough to rebuild every original hash from
+    // the x-axis deltas. After the original list of hashes has been
+    // tested, its storage is reused for the y-axis deltas.
+    //
     // The ASM for these loops contains more mov instructions than seem
     // necessary, and even an extra cmp/je pair for the std::vector length,
     // but no matter how I tweak things to tighten the loop it always ends
     // up slower. Not a huge deal, but this is a hot spot.
     std::vector<hashtype> hashdeltas_x;
-    std::vector<hashtype> hashdeltas_y;
+    std::vector<hashtype> rowstarts;
 
     if (testDeltaNum > 0) {
         const uint64_t nbH = hashes.size();
@@ -897,7 +1505,7 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
             }
         } else {
             hashdeltas_x.reserve(nbH);
-            hashdeltas_y.reserve(nbH);
+            rowstarts.reserve(nbH / testDeltaNum);
 
             // Test along the "x-axis", so that we produce (using
             // hash[y][x] notation, so that consecutive x values are
@@ -912,6 +1520,7 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
             // ...,
             for (size_t hnb = 0; hnb < nbH; hnb += (size_t)testDeltaNum) {
                 hashtype hprv = hashes[hnb];
+                rowstarts.emplace_back(hprv);
                 for (size_t hx = 1; hx < (size_t)testDeltaNum; hx++) {
                     hashtype h = hashes[hnb + hx];
                     hashdeltas_x.emplace_back(h ^ hprv);
@@ -919,24 +1528,6 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
                 }
                 hashdeltas_x.emplace_back(hashes[hnb] ^ hprv);
             }
-
-            // Test along the "y-axis", so that we produce (using
-            // hash[y][x] notation, so that consecutive x values are
-            // consecutive in memory):
-            //
-            // hash[0][0] ^ hash[1][0],
-            // hash[1][0] ^ hash[2][0],
-            // ...,
-            // hash[testDeltaNum - 2][0] ^ has[testDeltaNum - 1][0],
-            // hash[testDeltaNum - 1][0] ^ hash[0][0],
-            // hash[0][1] ^ hash[1][1],
-            // ...,
-            for (size_t hnb = (size_t)testDeltaNum; hnb < nbH; hnb++) {
-                hashdeltas_y.emplace_back(hashes[hnb - testDeltaNum      ] ^ hashes[hnb]);
-            }
-            for (size_t hnb = 0; hnb < (size_t)testDeltaNum; hnb++) {
-                hashdeltas_y.emplace_back(hashes[hnb - testDeltaNum + nbH] ^ hashes[hnb]);
-            }
         }
     }
 
@@ -946,6 +1537,41 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
 
     //----------
 
+    if (testDeltaNum > 2) {
+        const size_t rows = rowstarts.size();
+        assert((rows * testDeltaNum) == hashes.size());
+
+        // Test along the "y-axis", so that we produce (using
+        // hash[y][x] notation, so that consecutive x values are
+        // consecutive in memory):
+        //
+        // hash[0][0] ^ hash[1][0],
+        // hash[0][1] ^ hash[1][1],
+        // ...,
+        // hash[1][0] ^ hash[2][0],
+        // ...,
+        // hash[rows - 1][0] ^ hash[0][0],
+        // ...,
+        //
+        // Each pair of rows is rebuilt from its first hashes and the
+        // x-axis deltas as it goes, since hashes[] is now sorted.
+        for (size_t y = 0; y < rows; y++) {
+            const size_t     ynxt = (y + 1 == rows) ? 0 : y + 1;
+            const hashtype * dcur = &hashdeltas_x[y    * testDeltaNum];
+            const hashtype * dnxt = &hashdeltas_x[ynxt * testDeltaNum];
+            hashtype *       out  = &hashes[y * testDeltaNum];
+            hashtype hcur = rowstarts[y];
+            hashtype hnxt = rowstarts[ynxt];
+            for (size_t hx = 0; hx < (size_t)testDeltaNum; hx++) {
+                out[hx] = hcur ^ hnxt;
+                hcur    = hcur ^ dcur[hx];
+                hnxt    = hnxt ^ dnxt[hx];
+            }
+        }
+    }
+
+    //----------
+
     if (testDeltaNum > 0) {
         if (!REPORT(QUIET, reportFlags)) {
             printf("---Analyzing differential distribution\n");
@@ -957,7 +1583,7 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
             if (!REPORT(QUIET, reportFlags)) {
                 printf("---Analyzing additional differential distribution\n");
             }
-            result &= TestHashListSingle(hashdeltas_y, logpSumPtr, keyprint, testDeltaNum,
+            result &= TestHashListSingle(hashes, logpSumPtr, keyprint, testDeltaNum,
                     testFlags, reportFlags);
         }
     }
@@ -967,6 +1593,214 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
 
 INSTANTIATE(TestHashListImpl, HASHTYPELIST);
 
+//-----------------------------------------------------------------------------
+// These are the same tests as TestHashListSingle() and TestHashListImpl(),
+// but for keysets which were collected into HashSpills because they are
+// too large to test in memory. See HashSpill.h.
+//
+// Every collision count is computed in a single pass over the hashes in
+// sorted order, via a k-way merge of the spilled runs. The low-bits
+// collision counts need a second pass over the bit-reversed hashes, which
+// are collected into a second HashSpill during the first pass. The
+// distribution tests don't need the hashes to be in any particular order,
+// so they are done directly on the mapped scratch file.
+//
+// Failing keys cannot be reported on in this mode. The hashes are added
+// to the VCode in their original order (see HashSpill::vcode()), and the
+// collision counts are added as 32-bit values, so VCodes match those from
+// testing the same keyset in memory. Collision counts are 64-bit here,
+// since keysets too large for memory can easily exceed 2**31 of them.
+//
+// Every HashSpill given to this has been finish()ed, and so has released
+// its share of the memory budget, which the low-bits pass then uses.
+template <typename hashtype>
+static bool TestHashSpillSingle( HashSpill<hashtype> & hashes, int * logpSumPtr,
+        flags_t testFlags, flags_t reportFlags ) {
+    const unsigned hashbits     = hashtype::bitlen;
+    const uint64_t nbH          = hashes.size();
+    const bool     testMaxColl  = TEST(MAXCOLLISIONS, testFlags);
+    const bool     willTestDist = TEST(DISTRIBUTION,  testFlags);
+    const bool     testHighBits = TEST(HIGHBITS,      testFlags);
+    const bool     testLowBits  = TEST(LOWBITS,       testFlags);
+    bool           result       = true;
+    int            curlogp;
+
+    if (nbH == 0) {
+        return result;
+    }
+
+    if (TEST(COLLISIONS, testFlags)) {
+        std::set<int, std::greater<int>> nbBitsvec;
+        std::vector<uint64_t>            collcounts_fwd;
+        std::vector<uint64_t>            collcounts_rev;
+        int minBits = 0, maxBits = 0, threshBits = 0, minTBits = 0, maxTBits = 0;
+
+        if (!REPORT(QUIET, reportFlags)) {
+            printf("Testing all collisions (     %3i-bit)", hashbits);
+        }
+
+        if (testHighBits || testLowBits) {
+            FindCollBitRanges(nbH, hashbits, testMaxColl, willTestDist, nbBitsvec,
+                    minBits, maxBits, threshBits, minTBits, maxTBits);
+        }
+        const bool countHighBits = testHighBits && (maxBits > 0);
+        const bool countLowBits  = testLowBits  && (maxBits > 0);
+
+        std::unique_ptr<HashSpill<hashtype>> reversed;
+        if (countLowBits) {
+            reversed.reset(new HashSpill<hashtype>( g_maxMemory ));
+        }
+
+        mergeVCodeChunks(&hashes.vcode(), 1);
+
+        // The first pass counts full collisions, and partial collisions
+        // in the high bits if requested, while also collecting the
+        // bit-reversed hashes.
+        typename HashSpill<hashtype>::Merger merge( hashes );
+        uint64_t collcount = 0;
+        hashtype prev      = merge.next();
+
+        auto visit = [&]( const hashtype & h ) {
+            if (countLowBits) {
+                hashtype r = h;
+                r.reversebits();
+                reversed->push_back(r);
+            }
+        };
+        auto matchbits = [&]( uint64_t /* hnb */ ) {
+            const hashtype & h = merge.next();
+            const int hzb = (int)(prev ^ h).highzerobits();
+            collcount += (hzb == (int)hashbits);
+            visit(h);
+            prev = h;
+            return hzb;
+        };
+
+        visit(prev);
+        if (countHighBits) {
+            collcounts_fwd.resize(maxBits - minBits + 1);
+            CountRangedNbCollisionsBy(nbH, matchbits, minBits, maxBits, threshBits, &collcounts_fwd[0]);
+        } else {
+            for (uint64_t hnb = 1; hnb < nbH; hnb++) {
+                matchbits(hnb);
+            }
+        }
+        addVCodeResult((hidx_t)collcount);
+        addVCodeCollCounts(collcounts_fwd);
+
+        // The second pass counts partial collisions in the low bits
+        if (countLowBits) {
+            reversed->finish();
+
+            typename HashSpill<hashtype>::Merger rmerge( *reversed );
+            hashtype rprev = rmerge.next();
+
+            auto rmatchbits = [&]( uint64_t /* hnb */ ) {
+                const hashtype & r = rmerge.next();
+                const int hzb = (int)(rprev ^ r).highzerobits();
+                rprev = r;
+                return hzb;
+            };
+
+            collcounts_rev.resize(maxBits - minBits + 1);
+            CountRangedNbCollisionsBy(nbH, rmatchbits, minBits, maxBits, threshBits, &collcounts_rev[0]);
+            addVCodeCollCounts(collcounts_rev);
+
+            reversed.reset();
+        }
+
+        // Report on complete collisions, then on partial collisions in
+        // the same way as TestCollisions().
+        result &= ReportCollisions(nbH, collcount, hashbits,
+                &curlogp, false, false, false, reportFlags);
+        if (logpSumPtr != NULL) {
+            *logpSumPtr += curlogp;
+        }
+
+        for (const int nbBits: nbBitsvec) {
+            if ((nbBits < minBits) || (nbBits > maxBits)) {
+                continue;
+            }
+            bool reportMaxcoll = (testMaxColl && (nbBits <= threshBits)) ? true : false;
+            if (testHighBits) {
+                result &= ReportCollisions(nbH, collcounts_fwd[nbBits - minBits], nbBits,
+                        &curlogp, reportMaxcoll, true, true, reportFlags);
+                if (logpSumPtr != NULL) {
+                    *logpSumPtr += curlogp;
+                }
+            }
+            if (testLowBits) {
+                result &= ReportCollisions(nbH, collcounts_rev[nbBits - minBits], nbBits,
+                        &curlogp, reportMaxcoll, false, true, reportFlags);
+                if (logpSumPtr != NULL) {
+                    *logpSumPtr += curlogp;
+                }
+            }
+        }
+
+        if (countHighBits) {
+            int maxBits;
+            result &= ReportBitsCollisions(nbH, &collcounts_fwd[minTBits - minBits],
+                    minTBits, maxTBits, &curlogp, &maxBits, true, reportFlags);
+            if (logpSumPtr != NULL) {
+                *logpSumPtr += curlogp;
+            }
+        }
+        if (countLowBits) {
+            int maxBits;
+            result &= ReportBitsCollisions(nbH, &collcounts_rev[minTBits - minBits],
+                    minTBits, maxTBits, &curlogp, &maxBits, false, reportFlags);
+            if (logpSumPtr != NULL) {
+                *logpSumPtr += curlogp;
+            }
+        }
+    }
+
+    if (TEST(DISTRIBUTION, testFlags)) {
+        const int maxwidth = MaxDistBits(nbH);
+        const int minwidth = 8;
+
+        if (maxwidth >= minwidth) {
+            if (!REPORT(QUIET, reportFlags)) {
+                printf("Testing distribution   (any  %2i..%2i bits) - ", minwidth, maxwidth);
+            }
+
+            std::vector<double> scores;
+            int tests = TestDistributionScores(hashes.data(), nbH, maxwidth, minwidth, scores);
+
+            int bitstart, bitwidth;
+            result &= ReportDistribution(scores, tests, hashbits, maxwidth, minwidth,
+                    &curlogp, &bitstart, &bitwidth, reportFlags);
+            if (logpSumPtr != NULL) {
+                *logpSumPtr += curlogp;
+            }
+        }
+    }
+
+    return result;
+}
+
+// NB: This function is not intended to be used directly; see
+// TestHashList() and class TestHashListWrapper in Analyze.h.
+template <typename hashtype>
+bool TestHashSpillImpl( HashSpill<hashtype> & hashes, HashSpill<hashtype> * deltas, int * logpSumPtr,
+        flags_t testFlags, flags_t reportFlags ) {
+    bool result = true;
+
+    result &= TestHashSpillSingle(hashes, logpSumPtr, testFlags, reportFlags);
+
+    if (deltas != NULL) {
+        if (!REPORT(QUIET, reportFlags)) {
+            printf("---Analyzing differential distribution\n");
+        }
+        result &= TestHashSpillSingle(*deltas, logpSumPtr, testFlags | FLAG_TEST_DELTAXAXIS, reportFlags);
+    }
+
+    return result;
+}
+
+INSTANTIATE(TestHashSpillImpl, HASHTYPELIST);
+
 #if 0
 //----------------------------------------------------------------------------
 // Bytepair test - generate 16-bit indices from all possible non-overlapping
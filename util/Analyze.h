@@ -64,6 +64,13 @@ template <typename hashtype>
 bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn keyprint,
         unsigned testDeltaNum, flags_t testFlags, flags_t reportFlags );
 
+template <typename hashtype>
+class HashSpill;
+
+template <typename hashtype>
+bool TestHashSpillImpl( HashSpill<hashtype> & hashes, HashSpill<hashtype> * deltas, int * logpSumPtr,
+        flags_t testFlags, flags_t reportFlags );
+
 #define TEST(flagname, var) (!!(var & FLAG_TEST_ ## flagname))
 #define FLAG_TEST_COLLISIONS    (1 << 0)
 #define FLAG_TEST_MAXCOLLISIONS (1 << 1)
@@ -79,10 +86,16 @@ bool TestHashListImpl( std::vector<hashtype> & hashes, int * logpSumPtr, KeyFn k
 // template type of the class can be inferred from the type of the hash
 // vector. This is needed since we are on C++11, and class types can't be
 // automatically inferred from constructor parameters until C++17.
+//
+// The hashes may also be given as a HashSpill (see HashSpill.h), for
+// keysets too large to fit in memory. In that case, any list of deltas
+// must also be given as a HashSpill, and dumpFailKeys() is ignored.
 template <typename hashtype>
 class TestHashListWrapper {
   private:
-    std::vector<hashtype> & hashes_;
+    std::vector<hashtype> * hashes_;
+    HashSpill<hashtype> *   spill_;
+    HashSpill<hashtype> *   deltaSpill_;
     unsigned  deltaNum_;
     int *     logpSumPtr_;
     KeyFn     keyPrint_;
@@ -96,10 +109,16 @@ class TestHashListWrapper {
 
   public:
     inline TestHashListWrapper( std::vector<hashtype> & hashes ) :
-        hashes_( hashes ), deltaNum_( 0 ), logpSumPtr_( NULL ), keyPrint_( NULL ), reportFlags_( 0 ),
+        hashes_( &hashes ), spill_( NULL ), deltaSpill_( NULL ), deltaNum_( 0 ), logpSumPtr_( NULL ), keyPrint_( NULL ), reportFlags_( 0 ),
         testCollisions_( true ), testMaxCollisions_( false ), testDistribution_( true ),
         testHighBits_( true ), testLowBits_( true ), quietMode_( false ) {}
 
+    inline TestHashListWrapper( HashSpill<hashtype> & hashes ) :
+        hashes_( NULL ), spill_( &hashes ), deltaSpill_( NULL ), deltaNum_( 0 ),
+        logpSumPtr_( NULL ), keyPrint_( NULL ), reportFlags_( 0 ), testCollisions_( true ),
+        testMaxCollisions_( false ), testDistribution_( true ), testHighBits_( true ),
+        testLowBits_( true ), quietMode_( false ) {}
+
     inline TestHashListWrapper & sumLogp( int * p )         { logpSumPtr_       = p; return *this; }
 
     inline TestHashListWrapper & testCollisions( bool s )   { testCollisions_   = s; return *this; }
@@ -110,6 +129,8 @@ class TestHashListWrapper {
 
     inline TestHashListWrapper & testDeltas( unsigned n )   { deltaNum_         = n; return *this; }
 
+    inline TestHashListWrapper & testDeltas( HashSpill<hashtype> & d ) { deltaSpill_ = &d; return *this; }
+
     inline TestHashListWrapper & testHighBits( bool s )     { testHighBits_     = s; return *this; }
 
     inline TestHashListWrapper & testLowBits( bool s )      { testLowBits_      = s; return *this; }
@@ -132,7 +153,11 @@ class TestHashListWrapper {
         if (testHighBits_)      { testFlags_ |= FLAG_TEST_HIGHBITS;      }
         if (testLowBits_)       { testFlags_ |= FLAG_TEST_LOWBITS;       }
 
-        return TestHashListImpl(hashes_, logpSumPtr_, keyPrint_, deltaNum_,
+        if (spill_ != NULL) {
+            return TestHashSpillImpl(*spill_, deltaSpill_, logpSumPtr_,
+                    testFlags_, quietMode_ ? FLAG_REPORT_QUIET : reportFlags_);
+        }
+        return TestHashListImpl(*hashes_, logpSumPtr_, keyPrint_, deltaNum_,
                 testFlags_, quietMode_ ? FLAG_REPORT_QUIET : reportFlags_);
     }
 }; // class TestHashListWrapper
@@ -141,3 +166,8 @@ template <typename hashtype>
 TestHashListWrapper<hashtype> TestHashList( std::vector<hashtype> & hashes ) {
     return TestHashListWrapper<hashtype>(hashes);
 }
+
+template <typename hashtype>
+TestHashListWrapper<hashtype> TestHashList( HashSpill<hashtype> & hashes ) {
+    return TestHashListWrapper<hashtype>(hashes);
+}
@@ -18,7 +18,222 @@
  * <https://www.gnu.org/licenses/>.
  */
 #include "Platform.h"
-#include "Blob.h"
+#include "TestGlobals.h"
+#include "Instantiate.h"
+#include "Random.h"
+#include "Timing.h"
 
 //-----------------------------------------------------------------------------
-// Someday this will have Blob unit tests
+// Blob unit tests
+//
+// These check the word-wise and SIMD versions of the Blob operations
+// against simple byte- and bit-at-a-time versions of the same thing.
+
+template <typename blobtype>
+static bool refless( const blobtype & a, const blobtype & b ) {
+    for (size_t i = blobtype::len; i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i];
+        }
+    }
+    return false;
+}
+
+template <typename blobtype>
+static uint32_t refhighzerobits( const blobtype & a ) {
+    uint32_t zb = 0;
+
+    for (size_t i = blobtype::bitlen; i-- > 0;) {
+        if (a.getbit(i)) {
+            break;
+        }
+        zb++;
+    }
+    return zb;
+}
+
+template <typename blobtype>
+static uint32_t reflowzerobits( const blobtype & a ) {
+    uint32_t zb = 0;
+
+    for (size_t i = 0; i < blobtype::bitlen; i++) {
+        if (a.getbit(i)) {
+            break;
+        }
+        zb++;
+    }
+    return zb;
+}
+
+template <typename blobtype>
+static uint32_t refwindow( const blobtype & a, size_t start, size_t count ) {
+    uint32_t v = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        v |= a.getbit((start + i) % blobtype::bitlen) << i;
+    }
+    return v;
+}
+
+template <typename blobtype>
+static blobtype refreversebits( const blobtype & a ) {
+    blobtype r = 0;
+
+    for (size_t i = 0; i < blobtype::bitlen; i++) {
+        if (a.getbit(i)) {
+            r.flipbit(blobtype::bitlen - 1 - i);
+        }
+    }
+    return r;
+}
+
+template <typename blobtype>
+static bool test_blob_type( void ) {
+    const size_t TEST_SIZE = 4096;
+    std::vector<blobtype> blobs( TEST_SIZE );
+    bool passed = true;
+    Rand r( 8193, blobtype::bitlen );
+
+    r.rand_n(&blobs[0], blobtype::len * TEST_SIZE);
+    // Make sure there are some pairs which share long prefixes or
+    // suffixes, and some values with many zero bits.
+    for (size_t i = 0; i < TEST_SIZE; i += 4) {
+        const size_t n = r.rand_range(blobtype::len);
+        memcpy(&blobs[i + 1][0], &blobs[i][0], n);
+        memcpy(&blobs[i + 3][blobtype::len - n], &blobs[i + 2][blobtype::len - n], n);
+        memset(&blobs[i + 2][0], 0, n);
+    }
+
+    for (size_t i = 1; i < TEST_SIZE; i++) {
+        const blobtype & a = blobs[i - 1];
+        const blobtype & b = blobs[i];
+        const blobtype   x = a ^ b;
+        blobtype         y = a;
+
+        passed &= ((a < b) == refless(a, b));
+        passed &= ((b < a) == refless(b, a));
+        passed &= !(a < a);
+        passed &= (x.highzerobits() == refhighzerobits(x));
+        passed &= (x.lowzerobits()  == reflowzerobits(x));
+        y ^= b;
+        passed &= (x == y);
+        y.reversebits();
+        passed &= (y == refreversebits(x));
+
+        const size_t start = i % blobtype::bitlen;
+        const size_t count = 1 + (i % 24);
+        passed &= (a.window(start, count) == refwindow(a, start, count));
+    }
+
+    if (!passed) {
+        printf("Blob<%zd> self-test failed!\n", blobtype::bitlen);
+    }
+
+    return passed;
+}
+
+//-----------------------------------------------------------------------------
+// Blob micro-benchmarks
+//
+// These time the Blob operations which dominate the hash list analysis
+// code: operator < (sorting and merging), operator ^ plus highzerobits()
+// (prefix-collision counting), window() (distribution binning), and
+// reversebits() (low-bits collision counting). See also BlobsortBenchmark().
+
+static const size_t BENCH_SIZE = 1 << 20;
+static const size_t BENCH_ITER = 25;
+
+template <typename blobtype, typename F>
+static void bench_blob_op( const char * name, const std::vector<blobtype> & blobs, F op ) {
+    uint64_t mintime = UINT64_C(-1);
+    uint32_t sink    = 0;
+
+    for (size_t j = 0; j < BENCH_ITER; j++) {
+        uint64_t timeBegin = monotonic_clock();
+        sink += op(blobs);
+        uint64_t timeEnd   = monotonic_clock();
+        mintime = std::min(mintime, timeEnd - timeBegin);
+    }
+
+    printf("%3zu bits, %-28s %7.3f ns/op    [%08x]\n", blobtype::bitlen, name,
+            (double)mintime / (double)BENCH_SIZE, sink);
+}
+
+template <typename blobtype>
+static bool bench_blob_type( void ) {
+    std::vector<blobtype> blobs( BENCH_SIZE );
+    Rand r( 8194, blobtype::bitlen );
+
+    r.rand_n(&blobs[0], blobtype::len * BENCH_SIZE);
+    // Share a random-length prefix between neighbors, as in a sorted list
+    for (size_t i = 1; i < BENCH_SIZE; i += 2) {
+        const size_t n = r.rand_range(blobtype::len);
+        memcpy(&blobs[i][blobtype::len - n], &blobs[i - 1][blobtype::len - n], n);
+    }
+
+    bench_blob_op("operator <", blobs, []( const std::vector<blobtype> & b ) {
+            uint32_t sum = 0;
+            for (size_t i = 1; i < BENCH_SIZE; i++) {
+                sum += (b[i - 1] < b[i]) ? 1 : 0;
+            }
+            return sum;
+        });
+    bench_blob_op("operator ^ + highzerobits", blobs, []( const std::vector<blobtype> & b ) {
+            uint32_t sum = 0;
+            for (size_t i = 1; i < BENCH_SIZE; i++) {
+                sum += (b[i - 1] ^ b[i]).highzerobits();
+            }
+            return sum;
+        });
+    bench_blob_op("window", blobs, []( const std::vector<blobtype> & b ) {
+            uint32_t sum = 0;
+            for (size_t i = 0; i < BENCH_SIZE; i++) {
+                sum += b[i].window(i % blobtype::bitlen, 20);
+            }
+            return sum;
+        });
+    bench_blob_op("reversebits", blobs, []( const std::vector<blobtype> & b ) {
+            uint32_t sum = 0;
+            for (size_t i = 0; i < BENCH_SIZE; i++) {
+                blobtype t = b[i];
+                t.reversebits();
+                sum += t[0];
+            }
+            return sum;
+        });
+    printf("\n");
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+typedef bool (* BlobTestFn)( void );
+
+template <typename... T>
+static std::vector<BlobTestFn> BlobTestExpander( void ) {
+    return { &test_blob_type<T>... };
+}
+
+template <typename... T>
+static std::vector<BlobTestFn> BlobBenchExpander( void ) {
+    return { &bench_blob_type<T>... };
+}
+
+void BlobTest( void ) {
+    bool result = true;
+
+    for (BlobTestFn testFn: BlobTestExpander<HASHTYPELIST>()) {
+        result &= testFn();
+    }
+    if (!result) {
+        printf("Blob self-test failed! Cannot continue\n");
+        exit(1);
+    }
+    printf("Blob self-test passed.\n");
+}
+
+void BlobBenchmark( void ) {
+    for (BlobTestFn benchFn: BlobBenchExpander<HASHTYPELIST>()) {
+        benchFn();
+    }
+}
@@ -47,6 +47,10 @@
  */
 #include <algorithm>
 
+#if defined(HAVE_SSE_2)
+  #include "Intrinsics.h"
+#endif
+
 //-----------------------------------------------------------------------------
 #define _bytes ((size_t)(_bits + 7) / 8)
 template <unsigned _bits>
@@ -102,30 +106,7 @@ class Blob {
     // boolean operators
 
     bool operator < ( const Blob & k ) const {
-        size_t i = _bytes;
-#pragma GCC unroll 4
-        while (i >= 8) {
-            uint64_t a, b;
-            i -= 8;
-            memcpy(&a, &bytes[i], 8)  ; a = COND_BSWAP(a, isBE());
-            memcpy(&b, &k.bytes[i], 8); b = COND_BSWAP(b, isBE());
-            if (likely(a < b)) { return true; }
-            if (likely(a > b)) { return false; }
-        }
-        if (i >= 4) {
-            uint32_t a, b;
-            i -= 4;
-            memcpy(&a, &bytes[i], 4)  ; a = COND_BSWAP(a, isBE());
-            memcpy(&b, &k.bytes[i], 4); b = COND_BSWAP(b, isBE());
-            if (likely(a < b)) { return true; }
-            if (likely(a > b)) { return false; }
-        }
-        while (i >= 1) {
-            i -= 1;
-            if (likely(bytes[i] < k.bytes[i])) { return true; }
-            if (likely(bytes[i] > k.bytes[i])) { return false; }
-        }
-        return false;
+        return _less(bytes, k.bytes, _bytes);
     }
 
     bool operator == ( const Blob & k ) const {
@@ -200,6 +181,10 @@ class Blob {
         return _highzerobits(bytes, _bytes);
     }
 
+    FORCE_INLINE uint32_t lowzerobits( void ) const {
+        return _lowzerobits(bytes, _bytes);
+    }
+
     FORCE_INLINE uint32_t window( size_t start, size_t count ) const {
         return _window(start, count, bytes, _bytes);
     }
@@ -356,6 +341,72 @@ class Blob {
         }
     }
 
+    // Compares two byte strings as little-endian integers.
+    static FORCE_INLINE bool _less( const uint8_t * in1, const uint8_t * in2, const size_t len ) {
+#if defined(HAVE_SSE_2)
+        if ((len >= 16) && (len <= 32)) {
+            // The most-significant differing byte decides the result.
+            const uint32_t neq = _neqmask(in1, in2, len);
+            if (neq == 0) { return false; }
+            const uint32_t i = 31 - clz4(neq);
+            return in1[i] < in2[i];
+        }
+#endif
+        size_t i = len;
+#pragma GCC unroll 4
+        while (i >= 8) {
+            uint64_t a, b;
+            i -= 8;
+            memcpy(&a, &in1[i], 8); a = COND_BSWAP(a, isBE());
+            memcpy(&b, &in2[i], 8); b = COND_BSWAP(b, isBE());
+            if (likely(a < b)) { return true; }
+            if (likely(a > b)) { return false; }
+        }
+        if (i >= 4) {
+            uint32_t a, b;
+            i -= 4;
+            memcpy(&a, &in1[i], 4); a = COND_BSWAP(a, isBE());
+            memcpy(&b, &in2[i], 4); b = COND_BSWAP(b, isBE());
+            if (likely(a < b)) { return true; }
+            if (likely(a > b)) { return false; }
+        }
+        while (i >= 1) {
+            i -= 1;
+            if (likely(in1[i] < in2[i])) { return true; }
+            if (likely(in1[i] > in2[i])) { return false; }
+        }
+        return false;
+    }
+
+#if defined(HAVE_SSE_2)
+    // For wide Blobs, finding the first interesting byte via a SIMD
+    // compare and a bitmask avoids the hard-to-predict branches of
+    // walking word by word, which matters a lot when neighboring hashes
+    // share prefixes of varying lengths (as they do when sorted).
+    //
+    // This returns a bitmask with bit i set iff byte i of in1 differs
+    // from byte i of in2. It is only usable for 16 <= len <= 32. Lengths
+    // between those are handled with two overlapping 16-byte compares.
+    static FORCE_INLINE uint32_t _neqmask( const uint8_t * in1, const uint8_t * in2, const size_t len ) {
+  #if defined(HAVE_AVX2)
+        if (len == 32) {
+            const __m256i a = _mm256_loadu_si256((const __m256i *)in1);
+            const __m256i b = _mm256_loadu_si256((const __m256i *)in2);
+            return ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+        }
+  #endif
+        const __m128i alo = _mm_loadu_si128((const __m128i *)in1);
+        const __m128i blo = _mm_loadu_si128((const __m128i *)in2);
+        uint32_t      eq  = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(alo, blo));
+        if (len > 16) {
+            const __m128i ahi = _mm_loadu_si128((const __m128i *)(in1 + len - 16));
+            const __m128i bhi = _mm_loadu_si128((const __m128i *)(in2 + len - 16));
+            eq |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ahi, bhi)) << (len - 16);
+        }
+        return ~eq & (uint32_t)(UINT64_C(0xffffffff) >> (32 - len));
+    }
+#endif
+
     static FORCE_INLINE uint32_t _highzerobits( const uint8_t * bytes, const size_t len ) {
         uint32_t zb = 0;
         size_t i = len;
@@ -394,6 +445,45 @@ class Blob {
         return zb;
     }
 
+    // Counts trailing zero bits by isolating the lowest set bit, so that
+    // only a clz is needed.
+    static FORCE_INLINE uint32_t _lowzerobits( const uint8_t * bytes, const size_t len ) {
+        uint32_t zb = 0;
+        size_t i = 0;
+
+        while ((i + 8) <= len) {
+            uint64_t a;
+            memcpy(&a, &bytes[i], 8); a = COND_BSWAP(a, isBE());
+            i += 8;
+            if (a != 0) {
+                zb += 63 - clz8(a & (0 - a));
+                return zb;
+            }
+            zb += 64;
+        }
+        while ((i + 4) <= len) {
+            uint32_t a;
+            memcpy(&a, &bytes[i], 4); a = COND_BSWAP(a, isBE());
+            i += 4;
+            if (a != 0) {
+                zb += 31 - clz4(a & (0 - a));
+                return zb;
+            }
+            zb += 32;
+        }
+        while (i < len) {
+            uint32_t a;
+            a = bytes[i++];
+            if (a != 0) {
+                zb += 31 - clz4(a & (0 - a));
+                return zb;
+            }
+            zb += 8;
+        }
+
+        return zb;
+    }
+
     // Bit-windowing function.
     // Select some N-bit subset of the Blob, where N <= 24.
     static FORCE_INLINE uint32_t _window( size_t start, size_t count, const uint8_t * bytes, const size_t len ) {
@@ -507,12 +597,37 @@ class Blob {
         // (uint8_t)       =             hgfedcba
     }
 
+    // from the "Bit Twiddling Hacks" webpage
+    static FORCE_INLINE uint64_t _bitrev64( uint64_t v ) {
+        // swap odd and even bits
+        v = ((v >> 1) & UINT64_C(0x5555555555555555)) | ((v & UINT64_C(0x5555555555555555)) << 1);
+        // swap consecutive pairs
+        v = ((v >> 2) & UINT64_C(0x3333333333333333)) | ((v & UINT64_C(0x3333333333333333)) << 2);
+        // swap nibbles ...
+        v = ((v >> 4) & UINT64_C(0x0F0F0F0F0F0F0F0F)) | ((v & UINT64_C(0x0F0F0F0F0F0F0F0F)) << 4);
+        // swap all the bytes
+        return BSWAP64(v);
+    }
+
     // 0xf00f1001 => 0x8008f00f
+    //
+    // Each 64-bit word of the input is bit-reversed and stored to the
+    // mirrored offset, which handles 8 bytes at a time instead of 1.
     static FORCE_INLINE void _reversebits( uint8_t * bytes, const size_t len ) {
         VLA_ALLOC(uint8_t, tmp, len);
+        size_t i = 0;
 
-        for (size_t i = 0; i < len; i++) {
+        while ((i + 8) <= len) {
+            PUT_U64<false>(_bitrev64(GET_U64<false>(bytes, i)), tmp, len - i - 8);
+            i += 8;
+        }
+        if ((i + 4) <= len) {
+            PUT_U32<false>(_bitrev64(GET_U32<false>(bytes, i)) >> 32, tmp, len - i - 4);
+            i += 4;
+        }
+        while (i < len) {
             tmp[len - i - 1] = _byterev(bytes[i]);
+            i++;
         }
         memcpy(bytes, &tmp[0], len);
     }
@@ -761,3 +876,7 @@ class ExtBlob : private Blob<0> {
         _lrot(c, ptr, len);
     }
 }; // class ExtBlob
+
+//-----------------------------------------------------------------------------
+void BlobTest( void );
+void BlobBenchmark( void );
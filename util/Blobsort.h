@@ -111,12 +111,35 @@ static const uint32_t RADIX_BITS = 8;
 static const uint32_t RADIX_SIZE = (uint32_t)1 << RADIX_BITS;
 static const uint32_t RADIX_MASK = RADIX_SIZE - 1;
 
+// Move each of the count items in "from" to the queue given by
+// getqueue(i), via the array of pointers to the current position in each
+// queue. If track_idxs is true, then the matching entries in idxfrom[] are
+// moved to the same offsets in idxto[]. This is one pass of radixsort(),
+// but it is also usable for partitioning items by any other key, as long
+// as queue_ptrs[] was pre-arranged from the known sizes of each queue.
+template <bool track_idxs, typename T, typename F>
+static FORCE_INLINE void radixscatter( T * from, const T * to, T ** queue_ptrs, const hidx_t * idxfrom,
+        hidx_t * idxto, const size_t count, F getqueue ) {
+#pragma GCC unroll 4
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t index = getqueue(i);
+        if (track_idxs) {
+            *(idxto + (queue_ptrs[index] - to)) = std::move(idxfrom[i]);
+        }
+        *queue_ptrs[index]++ = std::move(from[i]);
+        // These prefetch() calls make a small but significant
+        // difference (e.g. 41.1ms -> 35.9ms).
+        prefetch(&from[i + 64]);
+        prefetch(queue_ptrs[index]);
+    }
+}
+
 template <bool track_idxs, typename T>
 static void radixsort( T * begin, T * end, hidx_t * idxs ) {
     constexpr uint32_t RADIX_LEVELS = T::len;
     const size_t   count        = end - begin;
 
-    uint32_t freqs[RADIX_SIZE][RADIX_LEVELS] = {};
+    hidx_t   freqs[RADIX_SIZE][RADIX_LEVELS] = {};
     T *      last = begin + count - 1;
 
     // Record byte frequencies in each position over all items except
@@ -145,9 +168,9 @@ static void radixsort( T * begin, T * end, hidx_t * idxs ) {
     T * from = begin;
     T * to   = queue_area.get();
 
-    std::unique_ptr<uint32_t[]> idxs_area( new uint32_t[track_idxs ? count : 1] );
-    uint32_t * idxfrom = idxs;
-    uint32_t * idxto   = idxs_area.get();
+    std::unique_ptr<hidx_t[]> idxs_area( new hidx_t[track_idxs ? count : 1] );
+    hidx_t * idxfrom = idxs;
+    hidx_t * idxto   = idxs_area.get();
 
     for (uint32_t pass = 0; pass < RADIX_LEVELS; pass++) {
         // If this pass would do nothing, just skip it.
@@ -167,18 +190,8 @@ static void radixsort( T * begin, T * end, hidx_t * idxs ) {
         }
 
         // Copy each element into its queue based on the current byte.
-#pragma GCC unroll 4
-        for (size_t i = 0; i < count; i++) {
-            uint8_t index = from[i][pass];
-            if (track_idxs) {
-                *(idxto + (queue_ptrs[index] - to)) = std::move(idxfrom[i]);
-            }
-            *queue_ptrs[index]++ = std::move(from[i]);
-            // These prefetch() calls make a small but significant
-            // difference (e.g. 41.1ms -> 35.9ms).
-            prefetch(&from[i + 64]);
-            prefetch(queue_ptrs[index]);
-        }
+        radixscatter<track_idxs>(from, to, queue_ptrs, idxfrom, idxto, count,
+                [&]( size_t i ) { return from[i][pass]; });
 
         if (track_idxs) {
             std::swap(idxfrom, idxto);
@@ -215,7 +228,7 @@ static void flagsort( T * begin, T * end, hidx_t * idxs, T * base, int digit ) {
     // Each pass must compute its own frequency table, because the
     // counts depend on all previous bytes, since each pass operates on
     // a successively smaller subset of the total list to sort.
-    uint32_t freqs[RADIX_SIZE] = {};
+    hidx_t   freqs[RADIX_SIZE] = {};
     T *      ptr = begin;
     do {
         ++freqs[(*ptr)[digit]];
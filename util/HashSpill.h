@@ -0,0 +1,272 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+// This requires Blobsort.h and VCode.h to have been included first.
+
+#include <queue>
+#include <string>
+#include <cstdlib>
+
+#if defined(HAVE_MMAP)
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// A HashSpill holds a list of hashes which may be too large to fit in
+// the memory budget given by --max-memory.
+//
+// Hashes are collected in batches sized to fit in that budget (leaving
+// room for sorting). Every live HashSpill's batch comes out of the same
+// budget, so a HashSpill gets at most whatever the others have left, and
+// it gives its share back once finish() is called. Each full batch is
+// sorted and appended to an unlinked scratch file as one "run". Once
+// finish() is called, the scratch file is mapped into memory, so that
+// the OS can page it in and out as needed. It can then be read in one of two ways. data()
+// gives the hashes as one flat array which is not sorted as a whole,
+// which is fine for order-independent statistics. A Merger visits
+// every hash in fully sorted order by doing a k-way merge of the runs.
+//
+// Since the runs are sorted, the original order of the hashes is lost,
+// so they are added to vcode() as they are flushed. Merging that chunk
+// gives exactly the VCode that one addVCodeOutput() call over the
+// whole list in its original order would.
+//
+// The scratch file is placed in $TMPDIR, or /tmp if that is not set.
+// If mmap() is not available, the scratch file is read back into
+// memory by finish(). This works, but it does not limit memory use.
+
+// The part of the --max-memory budget held by all live HashSpills
+inline uint64_t & HashSpillReserved( void ) {
+    static uint64_t reserved = 0;
+
+    return reserved;
+}
+
+template <typename hashtype>
+class HashSpill {
+  private:
+    static const size_t   MIN_BATCH = 1 << 16;
+
+    FILE *                f;
+    std::vector<hashtype> batch;
+    std::vector<uint64_t> runstarts;
+    uint64_t              spilled;
+    uint64_t              reserved;
+    const hashtype *      mapped;
+    vcode_chunk_t         vchunk;
+#if !defined(HAVE_MMAP)
+    std::vector<hashtype> readback;
+#endif
+
+    void flush( void ) {
+        if (batch.empty()) {
+            return;
+        }
+        addVCodeOutputPart(vchunk, &batch[0], hashtype::len * batch.size());
+        blobsort(batch.begin(), batch.end());
+        if (fwrite(&batch[0], sizeof(hashtype), batch.size(), f) != batch.size()) {
+            printf("Failed writing %zu hashes to HashSpill scratch file\n", batch.size());
+            exit(1);
+        }
+        runstarts.push_back(spilled);
+        spilled += batch.size();
+        batch.clear();
+    }
+
+    void releaseBatch( void ) {
+        std::vector<hashtype>().swap(batch);
+        HashSpillReserved() -= reserved;
+        reserved             = 0;
+    }
+
+  public:
+    // This uses at most maxbytes of the --max-memory budget, or less if
+    // other live HashSpills have already taken some of it.
+    HashSpill( uint64_t maxbytes ) : spilled( 0 ), mapped( NULL ), vchunk() {
+        if (g_maxMemory != 0) {
+            const uint64_t used = HashSpillReserved();
+            maxbytes = std::min(maxbytes, (g_maxMemory > used) ? g_maxMemory - used : 0);
+        }
+        // blobsort() may need as much memory again as the batch itself.
+        const size_t batchsize = std::max((size_t)(maxbytes / (2 * sizeof(hashtype))), MIN_BATCH);
+
+        batch.reserve(batchsize);
+        reserved             = 2 * sizeof(hashtype) * batchsize;
+        HashSpillReserved() += reserved;
+#if defined(HAVE_MMAP)
+        const char * tmpdir = getenv("TMPDIR");
+        std::string  name   = std::string((tmpdir != NULL) ? tmpdir : "/tmp") + "/SMHasher3-XXXXXX";
+        int          fd     = mkstemp(&name[0]);
+        if (fd < 0) {
+            printf("Failed creating HashSpill scratch file \"%s\"\n", name.c_str());
+            exit(1);
+        }
+        unlink(name.c_str());
+        f = fdopen(fd, "w+b");
+#else
+        f = tmpfile();
+#endif
+        if (f == NULL) {
+            printf("Failed opening HashSpill scratch file\n");
+            exit(1);
+        }
+    }
+
+    ~HashSpill() {
+#if defined(HAVE_MMAP)
+        if (mapped != NULL) {
+            munmap((void *)mapped, spilled * sizeof(hashtype));
+        }
+#endif
+        fclose(f);
+        releaseBatch();
+    }
+
+    HashSpill( const HashSpill & ) = delete;
+    HashSpill & operator = ( const HashSpill & ) = delete;
+
+    FORCE_INLINE void push_back( const hashtype & h ) {
+        batch.push_back(h);
+        if (unlikely(batch.size() == batch.capacity())) {
+            flush();
+        }
+    }
+
+    // This must be called after all hashes have been added, and before
+    // any of the accessors below are used.
+    void finish( void ) {
+        flush();
+        releaseBatch();
+        if (spilled != 0) {
+            addVCodeOutputLen(vchunk, hashtype::len * spilled);
+        }
+        if (fflush(f) != 0) {
+            printf("Failed writing to HashSpill scratch file\n");
+            exit(1);
+        }
+        if (spilled == 0) {
+            return;
+        }
+#if defined(HAVE_MMAP)
+        void * p = mmap(NULL, spilled * sizeof(hashtype), PROT_READ, MAP_SHARED, fileno(f), 0);
+        if (p == MAP_FAILED) {
+            printf("Failed mapping HashSpill scratch file\n");
+            exit(1);
+        }
+        mapped = (const hashtype *)p;
+#else
+        readback.resize(spilled);
+        rewind(f);
+        if (fread(&readback[0], sizeof(hashtype), spilled, f) != spilled) {
+            printf("Failed reading HashSpill scratch file\n");
+            exit(1);
+        }
+        mapped = &readback[0];
+#endif
+    }
+
+    uint64_t size( void ) const { return spilled + batch.size(); }
+
+    const hashtype * data( void ) const { return mapped; }
+
+    const vcode_chunk_t & vcode( void ) const { return vchunk; }
+
+    //----------
+    // Returns each hash in sorted order, one at a time, via next(). This
+    // must be called exactly size() times.
+    class Merger {
+      private:
+        struct Cursor {
+            const hashtype *  cur;
+            const hashtype *  end;
+        };
+        struct CursorGreater {
+            bool operator () ( const Cursor & a, const Cursor & b ) const { return *b.cur < *a.cur; }
+        };
+
+        std::priority_queue<Cursor, std::vector<Cursor>, CursorGreater> heap;
+
+      public:
+        Merger( const HashSpill & spill ) {
+            const size_t runs = spill.runstarts.size();
+
+            for (size_t i = 0; i < runs; i++) {
+                const uint64_t end = (i + 1 < runs) ? spill.runstarts[i + 1] : spill.spilled;
+                heap.push(Cursor { spill.mapped + spill.runstarts[i], spill.mapped + end });
+            }
+        }
+
+        FORCE_INLINE const hashtype & next( void ) {
+            Cursor c = heap.top();
+            heap.pop();
+            if (c.cur + 1 != c.end) {
+                prefetch(c.cur + 8);
+                heap.push(Cursor { c.cur + 1, c.end });
+            }
+            return *c.cur;
+        }
+    }; // class Merger
+}; // class HashSpill
+
+//-----------------------------------------------------------------------------
+// Keysets which are large enough to exceed the --max-memory budget when
+// held in memory should be tested using HashSpills. The in-memory case
+// needs room for the hashes, a list of deltas, and sorting space.
+template <typename hashtype>
+static bool UseHashSpill( const uint64_t nbH ) {
+    return (g_maxMemory != 0) && ((nbH * sizeof(hashtype) * 3) > g_maxMemory);
+}
+
+//-----------------------------------------------------------------------------
+// This collects the differences between consecutive hashes into a
+// second HashSpill as hashes are added to the first one, including the
+// wraparound difference between the last and first hashes. This is the
+// same set of deltas as TestHashList().testDeltas(1) would compute.
+template <typename hashtype>
+class HashSpillDeltas {
+  private:
+    HashSpill<hashtype> & hashes;
+    HashSpill<hashtype> & deltas;
+    hashtype  first, prev;
+    bool      empty;
+
+  public:
+    HashSpillDeltas( HashSpill<hashtype> & h, HashSpill<hashtype> & d ) :
+        hashes( h ), deltas( d ), empty( true ) {}
+
+    FORCE_INLINE void push_back( const hashtype & h ) {
+        if (likely(!empty)) {
+            deltas.push_back(h ^ prev);
+        } else {
+            first = h;
+            empty = false;
+        }
+        prev = h;
+        hashes.push_back(h);
+    }
+
+    void finish( void ) {
+        if (!empty) {
+            deltas.push_back(first ^ prev);
+        }
+        hashes.finish();
+        deltas.finish();
+    }
+}; // class HashSpillDeltas
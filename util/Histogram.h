@@ -18,10 +18,13 @@
  * <https://www.gnu.org/licenses/>.
  */
 
-#if defined(HAVE_AVX2) || defined(HAVE_SSE_4_1)
+#if defined(HAVE_AVX512_F) || defined(HAVE_AVX2) || defined(HAVE_SSE_4_1)
   #include "Intrinsics.h"
 #endif
 
+#include <vector>
+#include <type_traits>
+
 // This will add the value of each bit (0 or 1) of the hash value to the
 // corresponding entry in the histogram array of 32-bit unsigned integers, where
 // cursor points to the 0'th histogram entry (corresponding to the LSB of hash). The
@@ -32,7 +35,25 @@ template <typename hashtype>
 static inline uint32_t * HistogramHashBits( const hashtype & hash, uint32_t * cursor ) {
     const int hashbytes = hashtype::len;
 
-#if defined(HAVE_AVX2)
+#if defined(HAVE_AVX512_F)
+    const __m512i ONE = _mm512_set1_epi32(1);
+    for (unsigned oWord = 0; oWord < (hashbytes / 4); oWord++) {
+        // Get the next 32-bit chunk of the hash difference
+        uint32_t word;
+        memcpy(&word, ((const uint8_t *)&hash) + 4 * oWord, 4);
+
+        // Each 16-bit half of it is directly usable as a lane mask,
+        // selecting which of the next 16 counters get incremented.
+        __m512i cnt1 = _mm512_loadu_si512((const void *)cursor);
+        cnt1    = _mm512_mask_add_epi32(cnt1, (__mmask16)word, cnt1, ONE);
+        _mm512_storeu_si512((void *)cursor, cnt1);
+        cursor += 16;
+        __m512i cnt2 = _mm512_loadu_si512((const void *)cursor);
+        cnt2    = _mm512_mask_add_epi32(cnt2, (__mmask16)(word >> 16), cnt2, ONE);
+        _mm512_storeu_si512((void *)cursor, cnt2);
+        cursor += 16;
+    }
+#elif defined(HAVE_AVX2)
     const __m256i ONE  = _mm256_set1_epi32(1);
     const __m256i MASK = _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
     for (unsigned oWord = 0; oWord < (hashbytes / 4); oWord++) {
@@ -102,112 +123,92 @@ static inline uint32_t * HistogramHashBits( const hashtype & hash, uint32_t * cu
     return cursor;
 }
 
-// This will add the value of each bit (0 or 1) of the hash value to the
-// corresponding entry in the histogram array of 32-bit unsigned integers, but it
-// starts with the given startbit of the hash value. Cursor must point to the
-// histogram array entry corresponding to that starting bit. The size of the hash is
-// assumed to be divisible by 32 bits. Returns a pointer to the first histogram entry
-// beyond those for the given hash value. While this reads from and writes to memory
-// before the cursor pointer, it will always write back the bytes unchanged. But callers
-// must ensure that memory is valid to read+write.
+// This accumulates the bits of many hash values into per-bit counts, like
+// HistogramHashBits(), but keeps the running counts "bit-sliced": for each row
+// of counters, plane p holds bit p of every counter in that row, one hash-sized
+// word per plane. Adding a hash value to a row is then a ripple-carry add of the
+// hash words into the planes, which always runs through all PLANES of them, so
+// it is a fixed sequence of word-wide ANDs and XORs instead of one 32-bit
+// increment per hash bit.
+//
+// Callers add at most one hash value to any given row per "round", and must call
+// nextRound() after each round. After (2^PLANES - 1) rounds the planes would be
+// about to overflow, so nextRound() flushes them into the caller's 32-bit
+// counters; flush() must also be called once at the end. Both of those take a
+// function mapping a row number to a pointer to the counter for bit 0 of that
+// row, so that any counter layout can be used.
 
-template <typename hashtype>
-static inline uint32_t * HistogramHashBits( const hashtype & hash, uint32_t * cursor, size_t startbit ) {
-    const int hashbytes = hashtype::len;
+template <typename hashtype, unsigned PLANES = 8>
+class BitslicedHistogram {
+  protected:
+    typedef typename std::conditional<(hashtype::len % 8) == 0, uint64_t, uint32_t>::type word_t;
 
-#if defined(HAVE_AVX2)
-    const __m256i ONE       = _mm256_set1_epi32(1);
-    const __m256i MASK      = _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
-    const size_t  startWord = startbit / 32;
-    startbit &= 31;
-    // Align the cursor to the start of the chunk of 32 integer counters
-    cursor   -= startbit;
-    for (unsigned oWord = startWord; oWord < (hashbytes / 4); oWord++) {
-        // Get the next 32-bit chunk of the hash difference
-        uint32_t word;
-        memcpy(&word, ((const uint8_t *)&hash) + 4 * oWord, 4);
-        // Mask off the bits before startbit
-        word >>= startbit;
-        word <<= startbit;
+    static const size_t   WORDBITS  = sizeof(word_t) * 8;
+    static const size_t   WORDS     = hashtype::len / sizeof(word_t);
+    static const uint32_t MAXROUNDS = (UINT32_C(1) << PLANES) - 1;
 
-        // Expand it out into 4 sets of 8 32-bit integer words, with
-        // each integer being zero or one.
-        __m256i base  = _mm256_set1_epi32(word);
-        __m256i incr1 = _mm256_min_epu32(_mm256_and_si256(base, MASK), ONE);
-        base = _mm256_srli_epi32(base, 8);
-        __m256i incr2 = _mm256_min_epu32(_mm256_and_si256(base, MASK), ONE);
-        base = _mm256_srli_epi32(base, 8);
-        __m256i incr3 = _mm256_min_epu32(_mm256_and_si256(base, MASK), ONE);
-        base = _mm256_srli_epi32(base, 8);
-        __m256i incr4 = _mm256_min_epu32(_mm256_and_si256(base, MASK), ONE);
+    std::vector<word_t> planes;
+    size_t    rows;
+    uint32_t  rounds;
 
-        // Add these into the counts in the histogram.
-        __m256i cnt1 = _mm256_loadu_si256((const __m256i *)cursor);
-        cnt1     = _mm256_add_epi32(cnt1, incr1);
-        _mm256_storeu_si256((__m256i *)cursor, cnt1);
-        cursor  += 8;
-        __m256i cnt2 = _mm256_loadu_si256((const __m256i *)cursor);
-        cnt2     = _mm256_add_epi32(cnt2, incr2);
-        _mm256_storeu_si256((__m256i *)cursor, cnt2);
-        cursor  += 8;
-        __m256i cnt3 = _mm256_loadu_si256((const __m256i *)cursor);
-        cnt3     = _mm256_add_epi32(cnt3, incr3);
-        _mm256_storeu_si256((__m256i *)cursor, cnt3);
-        cursor  += 8;
-        __m256i cnt4 = _mm256_loadu_si256((const __m256i *)cursor);
-        cnt4     = _mm256_add_epi32(cnt4, incr4);
-        _mm256_storeu_si256((__m256i *)cursor, cnt4);
-        cursor  += 8;
-        // For all other times through the loop, leave the word variable unchanged
-        startbit = 0;
+    static FORCE_INLINE word_t getword( const hashtype & hash, size_t w ) {
+        word_t x;
+
+        memcpy(&x, &hash[w * sizeof(word_t)], sizeof(word_t));
+        return COND_BSWAP(x, isBE());
     }
-#elif defined(HAVE_SSE_4_1)
-    const __m128i ONE       = _mm_set1_epi32(1);
-    const __m128i MASK      = _mm_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3);
-    const size_t  startWord = startbit / 32;
-    startbit &= 31;
-    // Align the cursor to the start of the chunk of 32 integer counters
-    cursor   -= startbit;
-    for (unsigned oWord = startWord; oWord < (hashbytes / 4); oWord++) {
-        // Get the next 32-bit chunk of the hash difference
-        uint32_t word;
-        memcpy(&word, ((const uint8_t *)&hash) + 4 * oWord, 4);
-        // Mask off the bits before startbit
-        word >>= startbit;
-        word <<= startbit;
 
-        // Expand it out into 8 sets of 4 32-bit integer words, with
-        // each integer being zero or one, and add them into the
-        // counts in the histogram.
-        __m128i base = _mm_set1_epi32(word);
-        for (unsigned i = 0; i < 8; i++) {
-            __m128i incr = _mm_min_epu32(_mm_and_si128(base, MASK), ONE);
-            __m128i cnt  = _mm_loadu_si128((const __m128i *)cursor);
-            cnt     = _mm_add_epi32(cnt, incr);
-            _mm_storeu_si128((__m128i *)cursor, cnt);
-            base    = _mm_srli_epi32(base, 4);
-            cursor += 4;
+  public:
+    BitslicedHistogram( size_t nrows ) : planes( nrows * PLANES * WORDS ), rows( nrows ), rounds( 0 ) {}
+
+    // Add the value of each bit of the hash value, starting at startbit, into
+    // the given row. The ripple-carry always goes through every plane, since
+    // stopping early on random data mostly just mispredicts branches.
+    FORCE_INLINE void add( size_t row, const hashtype & hash, size_t startbit = 0 ) {
+        word_t *     plane     = &planes[row * PLANES * WORDS];
+        const size_t startWord = startbit / WORDBITS;
+        word_t       carry[WORDS];
+
+        for (size_t w = 0; w < WORDS; w++) {
+            carry[w] = (w < startWord) ? 0 : getword(hash, w);
+        }
+        carry[startWord] &= ~(word_t)0 << (startbit % WORDBITS);
+
+        for (unsigned p = 0; p < PLANES; p++) {
+            for (size_t w = 0; w < WORDS; w++) {
+                const word_t t = plane[w] & carry[w];
+                plane[w] ^= carry[w];
+                carry[w]  = t;
+            }
+            plane += WORDS;
         }
-        // For all other times through the loop, leave the word variable unchanged
-        startbit = 0;
     }
-#else
-    const size_t startByte = startbit / 8;
-    startbit &= 7;
-    // Align the cursor to the start of the chunk of 8 integer counters
-    cursor   -= startbit;
-    for (unsigned oByte = startByte; oByte < hashbytes; oByte++) {
-        uint8_t byte = hash[oByte];
-        // Mask off the bits before startbit
-        byte >>= startbit;
-        byte <<= startbit;
-        for (unsigned oBit = 0; oBit < 8; oBit++) {
-            (*cursor++) += byte & 1;
-            byte       >>= 1;
+
+    template <typename F>
+    void flush( F rowcounters ) {
+        for (size_t row = 0; row < rows; row++) {
+            const word_t * plane  = &planes[row * PLANES * WORDS];
+            uint32_t *     cursor = rowcounters(row);
+            for (unsigned p = 0; p < PLANES; p++) {
+                for (size_t w = 0; w < WORDS; w++) {
+                    const word_t v = plane[p * WORDS + w];
+                    if (v == 0) {
+                        continue;
+                    }
+                    for (size_t b = 0; b < WORDBITS; b++) {
+                        cursor[w * WORDBITS + b] += (uint32_t)((v >> b) & 1) << p;
+                    }
+                }
+            }
         }
-        // For all other times through the loop, leave the word variable unchanged
-        startbit = 0;
+        std::fill(planes.begin(), planes.end(), 0);
+        rounds = 0;
     }
-#endif
-    return cursor;
-}
+
+    template <typename F>
+    FORCE_INLINE void nextRound( F rowcounters ) {
+        if (++rounds == MAXROUNDS) {
+            flush(rowcounters);
+        }
+    }
+}; // class BitslicedHistogram
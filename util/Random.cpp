@@ -22,6 +22,10 @@
 #include "TestGlobals.h" // For Stats.h
 #include "Stats.h"       // For distribution testing
 
+#if defined(HAVE_AVX512_F) || defined(HAVE_AVX2)
+  #include "Intrinsics.h"
+#endif
+
 #include <algorithm>
 
 // Default to zero
@@ -181,6 +185,182 @@ static void threefry( void * buf, uint64_t & counter, const uint64_t * keyvals )
 #undef SINGLE_GIANT_LOOP
 }
 
+//-----------------------------------------------------------------------------
+// Fill a buffer with rounds * 4 * PARALLEL random uint64_t values, exactly
+// as if threefry() were called rounds times, updating the counter.
+//
+// Where the platform supports it, this evaluates many counters at once
+// using AVX2 or AVX-512, with each vector lane holding the state for a
+// different counter, and with 2 independent sets of vectors to hide
+// instruction latencies. Since the output for each counter is its 4 state
+// words together, the states then need to be transposed on their way out.
+// Any leftover rounds are done by the scalar code.
+#if defined(HAVE_AVX512_F)
+
+typedef __m512i tfvec_t;
+
+static FORCE_INLINE tfvec_t tf_set1( uint64_t x ) { return _mm512_set1_epi64(x); }
+
+static FORCE_INLINE tfvec_t tf_add( tfvec_t a, tfvec_t b ) { return _mm512_add_epi64(a, b); }
+
+static FORCE_INLINE tfvec_t tf_xor( tfvec_t a, tfvec_t b ) { return _mm512_xor_si512(a, b); }
+
+// The masked form avoids spurious GCC warnings about _mm512_undefined().
+template <int r>
+static FORCE_INLINE tfvec_t tf_rotl( tfvec_t a ) { return _mm512_mask_rol_epi64(a, 0xff, a, r); }
+
+static FORCE_INLINE tfvec_t tf_lanes( void ) { return _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0); }
+
+// Output for 8 counters, from the 4 state vectors, done entirely with
+// 2-source permutes (the other shuffles provoke spurious GCC warnings):
+//   t = { s0[0], s1[0], s0[1], s1[1], ... }
+//   u = { s2[0], s3[0], s2[1], s3[1], ... }
+//   out[0] = { t[0], t[1], u[0], u[1], t[2], t[3], u[2], u[3] }
+static FORCE_INLINE void tf_store( uint8_t * out, const tfvec_t * s ) {
+    const __m512i ilv_lo = _mm512_set_epi64(11,  3, 10,  2,  9,  1,  8,  0);
+    const __m512i ilv_hi = _mm512_set_epi64(15,  7, 14,  6, 13,  5, 12,  4);
+    const __m512i out_lo = _mm512_set_epi64(11, 10,  3,  2,  9,  8,  1,  0);
+    const __m512i out_hi = _mm512_set_epi64(15, 14,  7,  6, 13, 12,  5,  4);
+    __m512i       tlo    = _mm512_permutex2var_epi64(s[0], ilv_lo, s[1]);
+    __m512i       thi    = _mm512_permutex2var_epi64(s[0], ilv_hi, s[1]);
+    __m512i       ulo    = _mm512_permutex2var_epi64(s[2], ilv_lo, s[3]);
+    __m512i       uhi    = _mm512_permutex2var_epi64(s[2], ilv_hi, s[3]);
+
+    _mm512_storeu_si512((__m512i *)(out +   0), _mm512_permutex2var_epi64(tlo, out_lo, ulo));
+    _mm512_storeu_si512((__m512i *)(out +  64), _mm512_permutex2var_epi64(tlo, out_hi, ulo));
+    _mm512_storeu_si512((__m512i *)(out + 128), _mm512_permutex2var_epi64(thi, out_lo, uhi));
+    _mm512_storeu_si512((__m512i *)(out + 192), _mm512_permutex2var_epi64(thi, out_hi, uhi));
+}
+
+  #define TF_LANES 8
+
+#elif defined(HAVE_AVX2)
+
+typedef __m256i tfvec_t;
+
+static FORCE_INLINE tfvec_t tf_set1( uint64_t x ) { return _mm256_set1_epi64x(x); }
+
+static FORCE_INLINE tfvec_t tf_add( tfvec_t a, tfvec_t b ) { return _mm256_add_epi64(a, b); }
+
+static FORCE_INLINE tfvec_t tf_xor( tfvec_t a, tfvec_t b ) { return _mm256_xor_si256(a, b); }
+
+template <int r>
+static FORCE_INLINE tfvec_t tf_rotl( tfvec_t a ) {
+    return _mm256_or_si256(_mm256_slli_epi64(a, r), _mm256_srli_epi64(a, 64 - r));
+}
+
+static FORCE_INLINE tfvec_t tf_lanes( void ) { return _mm256_set_epi64x(3, 2, 1, 0); }
+
+// Output for 4 counters, from the 4 state vectors. See above.
+static FORCE_INLINE void tf_store( uint8_t * out, const tfvec_t * s ) {
+    __m256i a = _mm256_unpacklo_epi64(s[0], s[1]);
+    __m256i b = _mm256_unpackhi_epi64(s[0], s[1]);
+    __m256i c = _mm256_unpacklo_epi64(s[2], s[3]);
+    __m256i d = _mm256_unpackhi_epi64(s[2], s[3]);
+
+    _mm256_storeu_si256((__m256i *)(out +  0), _mm256_permute2x128_si256(a, c, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 32), _mm256_permute2x128_si256(b, d, 0x20));
+    _mm256_storeu_si256((__m256i *)(out + 64), _mm256_permute2x128_si256(a, c, 0x31));
+    _mm256_storeu_si256((__m256i *)(out + 96), _mm256_permute2x128_si256(b, d, 0x31));
+}
+
+  #define TF_LANES 4
+
+#endif
+
+#if defined(TF_LANES)
+
+  #define TF_SETS 2
+
+template <int r0, int r1>
+static FORCE_INLINE void tf_mix( tfvec_t & a, tfvec_t & b, tfvec_t & c, tfvec_t & d ) {
+    a = tf_add(a, b); b = tf_rotl<r0>(b); b = tf_xor(b, a);
+    c = tf_add(c, d); d = tf_rotl<r1>(d); d = tf_xor(d, c);
+}
+
+// These are the same 4 rounds in the same order as in threefry() above.
+static FORCE_INLINE void tf_rounds_a( tfvec_t * s ) {
+    tf_mix<14, 16>(s[0], s[1], s[2], s[3]);
+    tf_mix<52, 57>(s[0], s[3], s[2], s[1]);
+    tf_mix<23, 40>(s[0], s[1], s[2], s[3]);
+    tf_mix< 5, 37>(s[0], s[3], s[2], s[1]);
+}
+
+static FORCE_INLINE void tf_rounds_b( tfvec_t * s ) {
+    tf_mix<25, 33>(s[0], s[1], s[2], s[3]);
+    tf_mix<46, 12>(s[0], s[3], s[2], s[1]);
+    tf_mix<58, 22>(s[0], s[1], s[2], s[3]);
+    tf_mix<32, 32>(s[0], s[3], s[2], s[1]);
+}
+
+static FORCE_INLINE void tf_inject( tfvec_t * s, const tfvec_t * k, int k0, uint64_t n ) {
+    s[0] = tf_add(s[0], k[(k0 + 0) % 5]);
+    s[1] = tf_add(s[1], k[(k0 + 1) % 5]);
+    s[2] = tf_add(s[2], k[(k0 + 2) % 5]);
+    s[3] = tf_add(s[3], tf_add(k[(k0 + 3) % 5], tf_set1(n)));
+}
+
+static void threefry_n( void * buf, uint64_t & counter, const uint64_t * keyvals, size_t rounds ) {
+    constexpr size_t CTRS_PER_ITER   = TF_LANES * TF_SETS;
+    constexpr size_t ROUNDS_PER_ITER = CTRS_PER_ITER / PARALLEL;
+
+    static_assert((CTRS_PER_ITER % PARALLEL) == 0, "Vector threefry works in whole rounds");
+
+    uint8_t * out = static_cast<uint8_t *>(buf);
+    tfvec_t   k[5];
+
+    for (int i = 0; i < 5; i++) {
+        k[i] = tf_set1(keyvals[i]);
+    }
+
+    while (rounds >= ROUNDS_PER_ITER) {
+        tfvec_t s[TF_SETS][4];
+
+        for (int j = 0; j < TF_SETS; j++) {
+            const tfvec_t ctr = tf_add(tf_set1(counter + j * TF_LANES), tf_lanes());
+            s[j][0] = k[0];
+            s[j][1] = tf_add(k[1], ctr);
+            s[j][2] = tf_add(k[2], ctr);
+            s[j][3] = k[3];
+        }
+        for (int j = 0; j < TF_SETS; j++) { tf_rounds_a(s[j]);       }
+        for (int j = 0; j < TF_SETS; j++) { tf_inject(s[j], k, 1, 1); }
+        for (int j = 0; j < TF_SETS; j++) { tf_rounds_b(s[j]);       }
+        for (int j = 0; j < TF_SETS; j++) { tf_inject(s[j], k, 2, 2); }
+        for (int j = 0; j < TF_SETS; j++) { tf_rounds_a(s[j]);       }
+        for (int j = 0; j < TF_SETS; j++) { tf_inject(s[j], k, 3, 3); }
+        for (int j = 0; j < TF_SETS; j++) { tf_rounds_b(s[j]);       }
+        for (int j = 0; j < TF_SETS; j++) {
+            tf_store(out + j * TF_LANES * 32, s[j]);
+        }
+
+        counter += CTRS_PER_ITER;
+        out     += CTRS_PER_ITER * 32;
+        rounds  -= ROUNDS_PER_ITER;
+    }
+
+    while (rounds-- > 0) {
+        threefry(out, counter, keyvals);
+        out += Rand::BUFLEN * sizeof(uint64_t);
+    }
+}
+
+  #undef TF_SETS
+  #undef TF_LANES
+
+#else
+
+static void threefry_n( void * buf, uint64_t & counter, const uint64_t * keyvals, size_t rounds ) {
+    uint8_t * out = static_cast<uint8_t *>(buf);
+
+    while (rounds-- > 0) {
+        threefry(out, counter, keyvals);
+        out += Rand::BUFLEN * sizeof(uint64_t);
+    }
+}
+
+#endif
+
 //-----------------------------------------------------------------------------
 
 void Rand::refill_buf( void * buf ) {
@@ -213,10 +393,11 @@ void Rand::rand_n( void * buf, size_t bytes ) {
         memcpy(out, &rngbuf[bufidx], curbufbytes);
         out   += curbufbytes;
         bytes -= curbufbytes;
-        while (bytes > sizeof(rngbuf)) {
-            refill_buf(out);
-            out   += sizeof(rngbuf);
-            bytes -= sizeof(rngbuf);
+        if (bytes > sizeof(rngbuf)) {
+            const size_t rounds = (bytes - 1) / sizeof(rngbuf);
+            threefry_n(out, counter, xseed, rounds);
+            out   += rounds * sizeof(rngbuf);
+            bytes -= rounds * sizeof(rngbuf);
         }
         refill_buf(rngbuf);
         bufidx = 0;
@@ -321,6 +502,133 @@ static inline uint64_t feistel( const uint32_t k[RandSeq::FEISTEL_MAXROUNDS * 2]
     return r;
 }
 
+// This does the same thing as feistel() above, for FEISTEL_LANES
+// consecutive counter values starting at n, using AVX2 or AVX-512 to
+// compute feistelF() for many lanes at once. Those ISAs lack a 64x64-bit
+// multiply (outside of AVX512-DQ), but since one side is always the
+// constant phi, the low 64 bits of the product only need three 32x32-bit
+// multiplies. The AVX-512 code uses masked forms of some intrinsics to
+// avoid spurious GCC warnings about _mm512_undefined().
+#if defined(HAVE_AVX512_F)
+
+typedef __m512i fvec_t;
+
+static FORCE_INLINE void fv_store( uint64_t * p, fvec_t a ) { _mm512_storeu_si512((void *)p, a); }
+
+static FORCE_INLINE fvec_t fv_set1( uint64_t x ) { return _mm512_set1_epi64(x); }
+
+static FORCE_INLINE fvec_t fv_add( fvec_t a, fvec_t b ) { return _mm512_add_epi64(a, b); }
+
+static FORCE_INLINE fvec_t fv_xor( fvec_t a, fvec_t b ) { return _mm512_xor_si512(a, b); }
+
+static FORCE_INLINE fvec_t fv_and( fvec_t a, fvec_t b ) { return _mm512_and_si512(a, b); }
+
+static FORCE_INLINE fvec_t fv_mul32( fvec_t a, fvec_t b ) { return _mm512_mask_mul_epu32(a, 0xff, a, b); }
+
+static FORCE_INLINE fvec_t fv_shr32( fvec_t a ) { return _mm512_mask_srli_epi64(a, 0xff, a, 32); }
+
+static FORCE_INLINE fvec_t fv_shl32( fvec_t a ) { return _mm512_mask_slli_epi64(a, 0xff, a, 32); }
+
+static FORCE_INLINE fvec_t fv_shr( fvec_t a, uint64_t n ) { return _mm512_mask_srl_epi64(a, 0xff, a, _mm_cvtsi64_si128(n)); }
+
+static FORCE_INLINE fvec_t fv_shl( fvec_t a, uint64_t n ) { return _mm512_mask_sll_epi64(a, 0xff, a, _mm_cvtsi64_si128(n)); }
+
+static FORCE_INLINE fvec_t fv_lanes( void ) { return _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0); }
+
+  #define FEISTEL_VLANES 8
+
+#elif defined(HAVE_AVX2)
+
+typedef __m256i fvec_t;
+
+static FORCE_INLINE void fv_store( uint64_t * p, fvec_t a ) { _mm256_storeu_si256((__m256i *)p, a); }
+
+static FORCE_INLINE fvec_t fv_set1( uint64_t x ) { return _mm256_set1_epi64x(x); }
+
+static FORCE_INLINE fvec_t fv_add( fvec_t a, fvec_t b ) { return _mm256_add_epi64(a, b); }
+
+static FORCE_INLINE fvec_t fv_xor( fvec_t a, fvec_t b ) { return _mm256_xor_si256(a, b); }
+
+static FORCE_INLINE fvec_t fv_and( fvec_t a, fvec_t b ) { return _mm256_and_si256(a, b); }
+
+static FORCE_INLINE fvec_t fv_mul32( fvec_t a, fvec_t b ) { return _mm256_mul_epu32(a, b); }
+
+static FORCE_INLINE fvec_t fv_shr32( fvec_t a ) { return _mm256_srli_epi64(a, 32); }
+
+static FORCE_INLINE fvec_t fv_shl32( fvec_t a ) { return _mm256_slli_epi64(a, 32); }
+
+static FORCE_INLINE fvec_t fv_shr( fvec_t a, uint64_t n ) { return _mm256_srl_epi64(a, _mm_cvtsi64_si128(n)); }
+
+static FORCE_INLINE fvec_t fv_shl( fvec_t a, uint64_t n ) { return _mm256_sll_epi64(a, _mm_cvtsi64_si128(n)); }
+
+static FORCE_INLINE fvec_t fv_lanes( void ) { return _mm256_set_epi64x(3, 2, 1, 0); }
+
+  #define FEISTEL_VLANES 4
+
+#endif
+
+#if defined(FEISTEL_VLANES)
+
+  #define FEISTEL_LANES 16
+
+// value * phi, mod 2**64
+static FORCE_INLINE fvec_t fv_mulphi( fvec_t value ) {
+  #if defined(HAVE_AVX512_DQ)
+    return _mm512_mullo_epi64(value, fv_set1(UINT64_C(0x9E3779B97F4A7C15)));
+  #else
+    const fvec_t klo = fv_set1(UINT64_C(0x7F4A7C15));
+    const fvec_t khi = fv_set1(UINT64_C(0x9E3779B9));
+    const fvec_t lo  = fv_mul32(value, klo);
+    const fvec_t mid = fv_add(fv_mul32(fv_shr32(value), klo), fv_mul32(value, khi));
+
+    return fv_add(lo, fv_shl32(mid));
+  #endif
+}
+
+static FORCE_INLINE fvec_t feistelF_vec( fvec_t value, const uint32_t * subkeys, uint32_t round ) {
+    value = fv_add(value, fv_set1(subkeys[round])); value = fv_mulphi(value); value = fv_xor(value, fv_shr32(value));
+    value = fv_add(value, fv_set1(round));          value = fv_mulphi(value); value = fv_xor(value, fv_shr32(value));
+
+    return value;
+}
+
+static inline void feistel_n( const uint32_t k[RandSeq::FEISTEL_MAXROUNDS * 2],
+        const uint64_t n, const uint64_t bits, uint64_t * out ) {
+    constexpr size_t VECS = FEISTEL_LANES / FEISTEL_VLANES;
+
+    const uint64_t lbits  = bits / 2;
+    const uint64_t rbits  = bits - lbits;
+    const uint64_t lmask  = (UINT64_C(1) << lbits) - UINT64_C(1);
+    const uint64_t rmask  = (UINT64_C(1) << rbits) - UINT64_C(1);
+    const uint64_t rounds = RandSeq::FEISTEL_MAXROUNDS -
+            ((bits < 6) ? 0 : ((bits < 8) ? 1 : 2));
+
+    const fvec_t vlmask = fv_set1(lmask);
+    const fvec_t vrmask = fv_set1(rmask);
+    fvec_t       l[VECS], r[VECS];
+
+    for (size_t v = 0; v < VECS; v++) {
+        const fvec_t ctr = fv_add(fv_set1(n + v * FEISTEL_VLANES), fv_lanes());
+        l[v] = fv_and(ctr, vlmask);
+        r[v] = fv_and(fv_shr(ctr, lbits), vrmask);
+    }
+    for (uint64_t i = 0; i < rounds; i++) {
+        for (size_t v = 0; v < VECS; v++) {
+            l[v] = fv_xor(l[v], fv_and(feistelF_vec(r[v], k, 2 * i + 0), vlmask));
+        }
+        for (size_t v = 0; v < VECS; v++) {
+            r[v] = fv_xor(r[v], fv_and(feistelF_vec(l[v], k, 2 * i + 1), vrmask));
+        }
+    }
+    for (size_t v = 0; v < VECS; v++) {
+        fv_store(&out[v * FEISTEL_VLANES], fv_add(fv_shl(r[v], lbits), l[v]));
+    }
+}
+
+  #undef FEISTEL_VLANES
+
+#endif
+
 //-----------------------------------------------------------------------------
 // This is a table of data for constructing sets of numbers that have a
 // minimum of 3 bits difference. It comes from BCH error correcting codes
@@ -451,8 +759,7 @@ static inline void fill_seq( uint8_t * buf, const uint32_t k[RandSeq::FEISTEL_MA
         (min_dist == 2) ? elem_sz * 8 - 1      :
         (min_dist == 3) ? elem_sz * 8 - polytable[elem_sz][1] : 0;
 
-    for (uint64_t n = elem_lo; n != elem_hi; n++) {
-        uint64_t r = feistel(k, n, nbits);
+    auto emit = [&]( uint64_t r ) {
         if (min_dist == 0) {
             while (r > elem_sz) {
                 r = feistel(k, r, nbits);
@@ -467,6 +774,22 @@ static inline void fill_seq( uint8_t * buf, const uint32_t k[RandSeq::FEISTEL_MA
         }
         memcpy(buf, &r, elem_bytes);
         buf += stride;
+    };
+
+    // Only the first encryption of each counter value is vectorized. Any
+    // further cycle walking is done one element at a time.
+    uint64_t n = elem_lo;
+#if defined(FEISTEL_LANES)
+    for (; elem_hi - n >= FEISTEL_LANES; n += FEISTEL_LANES) {
+        uint64_t r[FEISTEL_LANES];
+        feistel_n(k, n, nbits, r);
+        for (uint64_t j = 0; j < FEISTEL_LANES; j++) {
+            emit(r[j]);
+        }
+    }
+#endif
+    for (; n != elem_hi; n++) {
+        emit(feistel(k, n, nbits));
     }
 }
 
@@ -508,10 +831,11 @@ static void fill_rand( uint8_t * out, const size_t elem_sz, const uint64_t elem_
         nbytes -= offset_size;
     }
 
-    while (nbytes >= bytes_per_fill) {
-        threefry(out, offset_rounds, xseed);
-        nbytes -= bytes_per_fill;
-        out    += bytes_per_fill;
+    if (nbytes >= bytes_per_fill) {
+        const size_t rounds = nbytes / bytes_per_fill;
+        threefry_n(out, offset_rounds, xseed, rounds);
+        nbytes -= rounds * bytes_per_fill;
+        out    += rounds * bytes_per_fill;
     }
 
     if (nbytes > 0) {
@@ -538,19 +862,8 @@ void RandSeq::fill_elem( uint8_t * out, const uint64_t elem_lo, const uint64_t e
 
 //-----------------------------------------------------------------------------
 
-bool RandSeq::write( void * buf, const uint64_t elem_lo, const uint64_t elem_n ) {
-    const uint64_t elem_hi = elem_lo + elem_n;
-    uint8_t *      out8    = reinterpret_cast<uint8_t *>(buf);
-
-    if (elem_lo > elem_hi) {
-        return false;
-    }
-    if (elem_hi > Rand::seq_maxelem(type, szelem)) {
-        return false;
-    }
-
+void RandSeq::write_range( uint8_t * out8, const uint64_t elem_lo, const uint64_t elem_hi ) {
     switch (type) {
-    default        : return false;
     case SEQ_DIST_1: fill_elem<1>(out8, elem_lo, elem_hi, szelem); break;
     case SEQ_DIST_2: fill_elem<2>(out8, elem_lo, elem_hi, szelem); break;
     case SEQ_DIST_3: fill_elem<3>(out8, elem_lo, elem_hi, szelem); break;
@@ -562,6 +875,44 @@ bool RandSeq::write( void * buf, const uint64_t elem_lo, const uint64_t elem_n )
                      }
                      break;
     }
+}
+
+// Since every element of a sequence can be computed independently from
+// its index, large writes are split into contiguous ranges across threads.
+// The output is the same no matter how the work is split.
+#define SEQ_THREAD_MIN (64 * 1024)
+
+bool RandSeq::write( void * buf, const uint64_t elem_lo, const uint64_t elem_n ) {
+    const uint64_t elem_hi = elem_lo + elem_n;
+    uint8_t *      out8    = reinterpret_cast<uint8_t *>(buf);
+
+    if ((type < SEQ_DIST_1) || (type > SEQ_NUM)) {
+        return false;
+    }
+    if (elem_lo > elem_hi) {
+        return false;
+    }
+    if (elem_hi > Rand::seq_maxelem(type, szelem)) {
+        return false;
+    }
+
+    if ((g_NCPU == 1) || g_inParallel || (elem_n < (uint64_t)SEQ_THREAD_MIN * g_NCPU)) {
+        write_range(out8, elem_lo, elem_hi);
+    } else {
+#if defined(HAVE_THREADS)
+        // SEQ_NUM elements are always uint64_t; szelem is their maximum value.
+        const uint64_t elem_bytes = (type == SEQ_NUM) ? sizeof(uint64_t) : szelem;
+        std::vector<std::thread> t(g_NCPU);
+        for (unsigned i = 0; i < g_NCPU; i++) {
+            const uint64_t lo = elem_lo + elem_n *  i      / g_NCPU;
+            const uint64_t hi = elem_lo + elem_n * (i + 1) / g_NCPU;
+            t[i] = std::thread(&RandSeq::write_range, this, out8 + (lo - elem_lo) * elem_bytes, lo, hi);
+        }
+        for (unsigned i = 0; i < g_NCPU; i++) {
+            t[i].join();
+        }
+#endif
+    }
 
     return true;
 }
@@ -697,6 +1048,21 @@ void RandTest( const unsigned runs ) {
             }
         }
 
+        // Ensure bulk generation exactly matches one round at a time
+        for (size_t j = 0; j < Randcount; j++) {
+            const Rand & r      = testRands1[j];
+            uint64_t     ctr1   = r.counter + j * 1013;
+            uint64_t     ctr2   = ctr1;
+            size_t       rounds = j % (Buf64len / Rand::BUFLEN + 1);
+            threefry_n(buf64_A[j], ctr1, r.xseed, rounds);
+            for (size_t k = 0; k < rounds; k++) {
+                threefry(&buf64_B[j][k * Rand::BUFLEN], ctr2, r.xseed);
+            }
+            VERIFY(ctr1 == ctr2, "Bulk threefry counter matches");
+            VERIFY(memcmp(buf64_A[j], buf64_B[j], rounds * Rand::BUFLEN * sizeof(uint64_t)) == 0,
+                    "Bulk threefry output matches");
+        }
+
         // Ensure Rand() and reseed() work the same
         Rand A1( WEAKRAND(5 * i) );
         Rand A2( 0 );
@@ -1182,6 +1548,31 @@ void RandTest( const unsigned runs ) {
             }
         }
 
+        progress("Large sequence writes");
+
+        // Ensure large write()s, which can be split across threads, match
+        // the same elements written in pieces too small to be split.
+        {
+            const uint64_t          bigcnt = 4 * SEQ_THREAD_MIN + 7;
+            const uint64_t          piece  = 1000;
+            const RandSeqType       types[4] = { SEQ_DIST_1, SEQ_DIST_2, SEQ_DIST_3, SEQ_NUM };
+            const uint32_t          sizes[4] = { 5, 4, 12, 0xffffffff };
+            std::vector<uint8_t>    big, pieces;
+
+            for (size_t m = 0; m < 4; m++) {
+                const size_t elembytes = (types[m] == SEQ_NUM) ? sizeof(uint64_t) : sizes[m];
+                RandSeq      rs        = testRands1[i % Randcount].get_seq(types[m], sizes[m]);
+
+                big.resize(bigcnt * elembytes);
+                pieces.resize(bigcnt * elembytes);
+                rs.write(&big[0], 0, bigcnt);
+                for (uint64_t n = 0; n < bigcnt; n += piece) {
+                    rs.write(&pieces[n * elembytes], n, std::min(piece, bigcnt - n));
+                }
+                VERIFY(big == pieces, "RandSeq large and piecewise write() outputs match");
+            }
+        }
+
         testRands1.clear();
         testRands2.clear();
     }
@@ -1199,18 +1590,34 @@ void RandBenchmark( void ) {
     uint64_t numgen = 0;
     double   deltat;
 
+    constexpr size_t ROUND_BYTES = Rand::BUFLEN * sizeof(uint64_t);
+    constexpr size_t TEST_ROUNDS = TEST_SIZE / ROUND_BYTES;
+    double rawdeltat;
+
     printf("Raw RNG.........................");
     deltat = UINT64_C(1) << 53;
     for (size_t i = 0; i < TEST_ITER; i++) {
         uint64_t keys[5] = { 1, 2, 3, 4, 5 };
         uint64_t begin   = cycle_timer_start();
-        for (size_t j = 0; j < TEST_SIZE / Rand::BUFLEN; j++) {
-            threefry(&buf[j * Rand::BUFLEN], numgen, keys);
+        for (size_t j = 0; j < TEST_ROUNDS; j++) {
+            threefry(&buf[j * ROUND_BYTES], numgen, keys);
         }
         uint64_t end     = cycle_timer_start();
         deltat = std::min(deltat, (double)(end - begin));
     }
-    printf("%8.2f\n", deltat / (TEST_SIZE / Rand::BUFLEN));
+    printf("%8.2f\n", deltat / TEST_ROUNDS);
+    rawdeltat = deltat;
+
+    printf("Raw RNG, bulk...................");
+    deltat = UINT64_C(1) << 53;
+    for (size_t i = 0; i < TEST_ITER; i++) {
+        uint64_t keys[5] = { 1, 2, 3, 4, 5 };
+        uint64_t begin   = cycle_timer_start();
+        threefry_n(buf, numgen, keys, TEST_ROUNDS);
+        uint64_t end     = cycle_timer_start();
+        deltat = std::min(deltat, (double)(end - begin));
+    }
+    printf("%8.2f\t(%.2fx)\n", deltat / TEST_ROUNDS, rawdeltat / deltat);
 
     printf("Object init.....................");
     deltat = UINT64_C(1) << 53;
@@ -425,6 +425,8 @@ class RandSeq {
     template <unsigned mindist>
     void fill_elem( uint8_t * out, const uint64_t elem_lo, const uint64_t elem_hi, const uint64_t elem_stride );
 
+    void write_range( uint8_t * out, const uint64_t elem_lo, const uint64_t elem_hi );
+
     // A bare RandSeq() object is unusable; initialize via Rand::get_seq().
     RandSeq() {}
 
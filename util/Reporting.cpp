@@ -167,7 +167,7 @@ void ShowOutliers( const std::vector<hashtype> & hashes, const std::vector<hidx_
     const hidx_t nbH = hashes.size();
     const uint32_t nbC = 1 << bitWidth;
     std::vector<uint32_t> counts(nbC);
-    for (uint32_t i = 0; i < nbH; i++) {
+    for (hidx_t i = 0; i < nbH; i++) {
         prefetch(&hashes[i + 4]);
         uint32_t index = hashes[i].window(bitOffset, bitWidth);
         counts[index]++;
@@ -198,7 +198,7 @@ void ShowOutliers( const std::vector<hashtype> & hashes, const std::vector<hidx_
     // hashes from more than maxEntries of those bins.
     const uint32_t maxbound = maxcounts[0];
     std::multimap<uint32_t, hidx_t> entries;
-    for (uint32_t i = 0; i < nbH; i++) {
+    for (hidx_t i = 0; i < nbH; i++) {
         prefetch(&hashes[i + 4]);
         uint32_t index = hashes[i].window(bitOffset, bitWidth);
         if (counts[index] < maxbound) {
@@ -493,7 +493,7 @@ bool ReportChiSqIndep( const uint32_t * popcount, const uint32_t * andcount, siz
 }
 
 //-----------------------------------------------------------------------------
-bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int * logpp,
+bool ReportCollisions( uint64_t const nbH, uint64_t collcount, unsigned hashsize, int * logpp,
         bool maxcoll, bool highbits, bool header, const flags_t flags ) {
     bool largehash = hashsize > (8 * sizeof(uint32_t));
 
@@ -507,7 +507,7 @@ bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int
 
     if (maxcoll) {
         expected = EstimateMaxCollisions(nbH, hashsize);
-        p_value  = EstimateMaxCollPValue(nbH, hashsize, collcount);
+        p_value  = EstimateMaxCollPValue(nbH, hashsize, (int)std::min(collcount, (uint64_t)INT32_MAX));
     } else {
         expected = EstimateNbCollisions(nbH, hashsize);
         p_value  = GetBoundedPoissonPValue(expected, collcount);
@@ -545,9 +545,9 @@ bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int
         ratio = (expected < 0.1) ? 1.00 : 0.00;
     } else if (expected < 0.01) {
         ratio = INFINITY;
-    } else if (collcount == (int)round(expected)) {
+    } else if (collcount == (uint64_t)round(expected)) {
         ratio = 1.00;
-    } else if (!largehash && (collcount == (int)round(expected + 0.4))) {
+    } else if (!largehash && (collcount == (uint64_t)round(expected + 0.4))) {
         ratio = 1.00;
     } else {
         ratio = double(collcount) / expected;
@@ -576,11 +576,11 @@ bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int
         // (10 characters - 1 decimal point - 1 digit after the decimal),
         // but some hashes greatly exceed expected collision counts.
         if (!isfinite(ratio)) {
-            printf(" - Expected %10.1f, actual %10i  (------) ", expected, collcount);
+            printf(" - Expected %10.1f, actual %10" PRIu64 "  (------) ", expected, collcount);
         } else if (ratio < 9.0) {
-            printf(" - Expected %10.1f, actual %10i  (%5.3fx) ", expected, collcount, ratio);
+            printf(" - Expected %10.1f, actual %10" PRIu64 "  (%5.3fx) ", expected, collcount, ratio);
         } else {
-            printf(" - Expected %10.1f, actual %10i  (%#.4gx) ", expected, collcount, ratio);
+            printf(" - Expected %10.1f, actual %10" PRIu64 "  (%#.4gx) ", expected, collcount, ratio);
         }
 
         // Since ratios and p-value summaries are most important to humans,
@@ -589,9 +589,11 @@ bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int
         // in --verbose mode.
         if (REPORT(MORESTATS, flags)) {
             if (p_value > 0.00001) {
-                printf("(^%2d) (p<%8.6f) (%+i)", logp_value, p_value, collcount - (int)round(expected));
+                printf("(^%2d) (p<%8.6f) (%+" PRId64 ")", logp_value, p_value,
+                        (int64_t)collcount - (int64_t)round(expected));
             } else {
-                printf("(^%2d) (p<%.2e) (%+i)", logp_value, p_value, collcount - (int)round(expected));
+                printf("(^%2d) (p<%.2e) (%+" PRId64 ")", logp_value, p_value,
+                        (int64_t)collcount - (int64_t)round(expected));
             }
         } else {
             printf("(^%2d)", logp_value);
@@ -610,7 +612,7 @@ bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int
 }
 
 //-----------------------------------------------------------------------------
-bool ReportBitsCollisions( uint64_t nbH, const int * collcounts, int minBits, int maxBits,
+bool ReportBitsCollisions( uint64_t nbH, const uint64_t * collcounts, int minBits, int maxBits,
         int * logpp, int * maxbitsp, bool highbits, const flags_t flags ) {
     if ((maxBits <= 1) || (minBits > maxBits)) { return true; }
 
@@ -620,18 +622,18 @@ bool ReportBitsCollisions( uint64_t nbH, const int * collcounts, int minBits, in
                 printf("Testing all collisions (%s %2i..%2i bits) - ", highbits ? "high" : "low ", minBits, maxBits);
     }
 
-    double maxCollDev     = 0.0;
-    int    maxCollDevBits = 0;
-    int    maxCollDevNb   = 0;
-    double maxCollDevExp  = 1.0;
-    double maxPValue      = INFINITY;
+    double   maxCollDev     = 0.0;
+    int      maxCollDevBits = 0;
+    uint64_t maxCollDevNb   = 0;
+    double   maxCollDevExp  = 1.0;
+    double   maxPValue      = INFINITY;
 
     for (int b = minBits; b <= maxBits; b++) {
-        int const    nbColls  = collcounts[b - minBits];
-        double const expected = EstimateNbCollisions(nbH, b);
+        uint64_t const nbColls  = collcounts[b - minBits];
+        double const   expected = EstimateNbCollisions(nbH, b);
         assert(expected > 0.0);
-        double const dev      = (double)nbColls / expected;
-        double const p_value  = GetBoundedPoissonPValue(expected, nbColls);
+        double const   dev      = (double)nbColls / expected;
+        double const   p_value  = GetBoundedPoissonPValue(expected, nbColls);
         // printf("%d bits, %d/%f, p %f\n", b, nbColls, expected, p_value);
         if (p_value < maxPValue) {
             maxPValue      = p_value;
@@ -663,7 +665,7 @@ bool ReportBitsCollisions( uint64_t nbH, const int * collcounts, int minBits, in
 
     if (!REPORT(QUIET, flags)) {
         int          i_maxCollDevExp = (int)round(maxCollDevExp);
-        spacelen -= printf("Worst is %2i bits: %i/%i ", maxCollDevBits, maxCollDevNb, i_maxCollDevExp);
+        spacelen -= printf("Worst is %2i bits: %" PRIu64 "/%i ", maxCollDevBits, maxCollDevNb, i_maxCollDevExp);
         if (spacelen < 0) {
             spacelen = 0;
         }
@@ -682,9 +684,11 @@ bool ReportBitsCollisions( uint64_t nbH, const int * collcounts, int minBits, in
 
         if (REPORT(MORESTATS, flags)) {
             if (p_value > 0.00001) {
-                printf("(^%2d) (p<%8.6f) (%+i)", logp_value, p_value, maxCollDevNb - i_maxCollDevExp);
+                printf("(^%2d) (p<%8.6f) (%+" PRId64 ")", logp_value, p_value,
+                        (int64_t)maxCollDevNb - i_maxCollDevExp);
             } else {
-                printf("(^%2d) (p<%.2e) (%+i)", logp_value, p_value, maxCollDevNb - i_maxCollDevExp);
+                printf("(^%2d) (p<%.2e) (%+" PRId64 ")", logp_value, p_value,
+                        (int64_t)maxCollDevNb - i_maxCollDevExp);
             }
         } else {
             printf("(^%2d)", logp_value);
@@ -790,3 +794,46 @@ bool ReportDistribution( const std::vector<double> & scores, int tests, int hash
 
     return !failure;
 }
+
+//-----------------------------------------------------------------------------
+// Report on a p-value which was computed by the caller, for tests which
+// don't fit any of the more specialized reporting functions above. The
+// caller is expected to have already printed a description of the
+// result on the current line.
+bool ReportPValue( double p_value, int * logpp, const flags_t flags ) {
+    int logp_value = GetLog2PValue(p_value);
+
+    recordLog2PValue(logp_value);
+    if (logpp != NULL) {
+        *logpp = logp_value;
+    }
+
+    bool warning = false, failure = false;
+    if (p_value <= FAILURE_PBOUND) {
+        failure = true;
+    } else if (p_value <= WARNING_PBOUND) {
+        warning = true;
+    }
+
+    if (!REPORT(QUIET, flags)) {
+        if (REPORT(MORESTATS, flags)) {
+            if (p_value > 0.00001) {
+                printf("(^%2d) (p<%8.6f)", logp_value, p_value);
+            } else {
+                printf("(^%2d) (p<%.2e)", logp_value, p_value);
+            }
+        } else {
+            printf("(^%2d)", logp_value);
+        }
+
+        if (failure) {
+            printf(" !!!!!\n");
+        } else if (warning) {
+            printf(" !\n");
+        } else {
+            printf("\n");
+        }
+    }
+
+    return !failure;
+}
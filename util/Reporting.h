@@ -67,11 +67,13 @@ bool ReportBias( const uint32_t * counts, const int coinflips, const int trials,
 bool ReportChiSqIndep( const uint32_t * popcount, const uint32_t * andcount, size_t keybits,
         size_t hashbits, size_t testcount, const flags_t flags );
 
-bool ReportCollisions( uint64_t const nbH, int collcount, unsigned hashsize, int * logpp,
+bool ReportCollisions( uint64_t const nbH, uint64_t collcount, unsigned hashsize, int * logpp,
         bool maxcoll, bool highbits, bool header, const flags_t flags );
 
-bool ReportBitsCollisions( uint64_t nbH, const int * collcounts, int minBits, int maxBits,
+bool ReportBitsCollisions( uint64_t nbH, const uint64_t * collcounts, int minBits, int maxBits,
         int * logpp, int * maxbitsp, bool highbits, const flags_t flags );
 
 bool ReportDistribution( const std::vector<double> & score, int tests, int hashbits, int maxwidth, int minwidth,
         int * logpp, int * worstStartp, int * worstWidthp, const flags_t flags );
+
+bool ReportPValue( double p_value, int * logpp, const flags_t flags );
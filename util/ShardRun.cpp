@@ -0,0 +1,206 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include "Platform.h"
+#include "Hashinfo.h"
+#include "TestGlobals.h"
+#include "ShardRun.h"
+
+#include <map>
+
+//-----------------------------------------------------------------------------
+// A shard file is a short text header, followed by any number of records.
+// Each record is a text line giving its name and length, then that many
+// bytes of raw data, and then a newline. Once the shard's run has
+// finished all of its tests, a final "complete" line is added. Until
+// then, the file only holds whatever was saved so far, so shard files
+// without that line cannot be merged.
+
+typedef std::map<std::string, std::string> shardrecords_t;
+
+unsigned g_shardIndex = 0;
+unsigned g_shardCount = 0;
+const char * g_shardFile = NULL;
+std::vector<std::string> g_mergeFiles;
+
+static const char   shardhdr[] = "SMHasher3 shard v1";
+static std::string  shardconfig;
+static shardrecords_t savedrecords;
+static bool           shardcomplete = false;
+static std::vector<shardrecords_t> mergedrecords;
+
+static void ShardWrite( void ) {
+    const std::string tmpname = std::string(g_shardFile) + ".tmp";
+    FILE *            f       = fopen(tmpname.c_str(), "wb");
+
+    if (f == NULL) {
+        printf("Failed to open shard file \"%s\" for writing\n", tmpname.c_str());
+        exit(1);
+    }
+
+    fprintf(f, "%s\n%s\nshard %u %u\n", shardhdr, shardconfig.c_str(), g_shardIndex, g_shardCount);
+    for (const auto & record: savedrecords) {
+        fprintf(f, "record %s %zu\n", record.first.c_str(), record.second.size());
+        fwrite(record.second.data(), 1, record.second.size(), f);
+        fputc('\n', f);
+    }
+    if (shardcomplete) {
+        fprintf(f, "complete\n");
+    }
+
+    if ((ferror(f) != 0) || (fclose(f) != 0) || ((rename(tmpname.c_str(), g_shardFile) != 0) &&
+            ((remove(g_shardFile) != 0) || (rename(tmpname.c_str(), g_shardFile) != 0)))) {
+        printf("Failed to write shard file \"%s\"\n", g_shardFile);
+        exit(1);
+    }
+}
+
+static void ShardRead( const std::string & filename, unsigned & index, unsigned & count, shardrecords_t & records ) {
+    bool complete = false;
+    FILE * f = fopen(filename.c_str(), "rb");
+
+    if (f == NULL) {
+        printf("Failed to open shard file \"%s\"\n", filename.c_str());
+        exit(1);
+    }
+
+    // No record can be longer than the file it is in.
+    fseek(f, 0, SEEK_END);
+    const long filesize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    std::vector<char> line( shardconfig.size() + 2 );
+    bool valid = (fgets(&line[0], line.size(), f) != NULL) &&
+            (strncmp(&line[0], shardhdr, sizeof(shardhdr) - 1) == 0) &&
+            (fgets(&line[0], line.size(), f) != NULL) && (shardconfig + "\n" == &line[0]);
+
+    if (!valid) {
+        printf("Shard file \"%s\" is invalid, or is not for this hash and settings\n", filename.c_str());
+        exit(1);
+    }
+
+    valid = (fscanf(f, "shard %u %u", &index, &count) == 2) && (index < count);
+    while (valid && !complete) {
+        char   tag[16];
+        char   name[256];
+        size_t len = 0;
+        if (fscanf(f, " %15s", tag) != 1) {
+            break;
+        }
+        if (strcmp(tag, "complete") == 0) {
+            complete = true;
+            valid    = (fgetc(f) == '\n') && (fgetc(f) == EOF);
+            break;
+        }
+        int fields = fscanf(f, " %255s %zu", name, &len);
+        valid = (strcmp(tag, "record") == 0) && (fields == 2) && (fgetc(f) == '\n') &&
+                (filesize >= 0) && (len <= (size_t)filesize);
+        if (!valid) {
+            break;
+        }
+        std::string data( len, '\0' );
+        valid = ((len == 0) || (fread(&data[0], 1, len, f) == len)) && (fgetc(f) == '\n');
+        if (valid) {
+            records[name].swap(data);
+        }
+    }
+    fclose(f);
+
+    if (!valid) {
+        printf("Shard file \"%s\" is corrupt\n", filename.c_str());
+        exit(1);
+    }
+    if (!complete) {
+        printf("Shard file \"%s\" is incomplete; its shard run did not finish\n", filename.c_str());
+        exit(1);
+    }
+}
+
+void ShardInit( const HashInfo * hinfo, bool extra ) {
+    char config[512];
+
+    snprintf(config, sizeof(config), "hash %s seed %016" PRIx64 " endian %u extra %u",
+            hinfo->name, (uint64_t)g_seed, (unsigned)g_hashEndian, extra ? 1 : 0);
+    shardconfig = config;
+
+    if (ShardPartial()) {
+        printf("Running shard %u of %u, saving results to \"%s\"\n", g_shardIndex, g_shardCount, g_shardFile);
+        ShardWrite();
+        return;
+    }
+
+    if (!ShardMerging()) {
+        return;
+    }
+
+    // Every shard must be present exactly once.
+    std::vector<unsigned> counts;
+    unsigned total = 0;
+    for (const std::string & filename: g_mergeFiles) {
+        shardrecords_t records;
+        unsigned       index, count;
+
+        ShardRead(filename, index, count, records);
+        if (total == 0) {
+            total = count;
+            counts.resize(count, 0);
+            mergedrecords.resize(count);
+        }
+        if ((count != total) || (counts[index]++ != 0)) {
+            printf("Shard file \"%s\" is shard %u of %u, which conflicts with other shard files\n",
+                    filename.c_str(), index, count);
+            exit(1);
+        }
+        mergedrecords[index].swap(records);
+    }
+    if (g_mergeFiles.size() != total) {
+        printf("Only %zu of %u shard files were given to merge\n", g_mergeFiles.size(), total);
+        exit(1);
+    }
+}
+
+void ShardFinish( void ) {
+    if (!ShardPartial()) {
+        return;
+    }
+    shardcomplete = true;
+    ShardWrite();
+}
+
+void ShardSave( const std::string & name, const void * data, size_t len ) {
+    savedrecords[name].assign((const char *)data, len);
+    ShardWrite();
+}
+
+void ShardSave( const std::string & name, const std::string & data ) {
+    ShardSave(name, data.data(), data.size());
+}
+
+std::vector<std::string> ShardRecords( const std::string & name ) {
+    std::vector<std::string> found;
+
+    for (const shardrecords_t & records: mergedrecords) {
+        auto it = records.find(name);
+        if (it != records.end()) {
+            found.push_back(it->second);
+        }
+    }
+
+    return found;
+}
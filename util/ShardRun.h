@@ -0,0 +1,77 @@
+/*
+ * SMHasher3
+ * Copyright (C) 2021-2023  Frank J. T. Wojcik
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Sharded test runs
+//
+// With --shard=<i>/<N>,<file>, tests which support it do only the i'th of
+// N deterministic slices of their work (e.g. key bits or seed blocks),
+// and save their partial results as named records in <file>. With
+// --merge=<file>[,<file>...], those tests instead read the records back
+// from all N shard files, and report on them exactly as a single run over
+// all the work would have, including VCodes. Tests which don't support
+// sharding simply run in full in every shard and in the merge.
+//
+// A shard file is only marked as complete by ShardFinish(), once all of
+// that shard's tests are done, and only complete shard files can be
+// merged, so a crashed or interrupted shard can't be mistaken for a
+// finished one.
+//
+// Shard files are only meaningful to the same build of SMHasher3, testing
+// the same hash with the same seed, endianness, and --extra settings.
+
+// Set from the command line. g_shardCount is 0 if not sharding.
+extern unsigned g_shardIndex;
+extern unsigned g_shardCount;
+extern const char * g_shardFile;
+extern std::vector<std::string> g_mergeFiles;
+
+static inline bool ShardMerging( void ) {
+    return !g_mergeFiles.empty();
+}
+
+static inline bool ShardPartial( void ) {
+    return g_shardCount != 0;
+}
+
+// Does this process do the given piece of work? Merging does none.
+static inline bool ShardOwns( uint64_t workitem ) {
+    return !ShardMerging() && ((g_shardCount == 0) || ((workitem % g_shardCount) == g_shardIndex));
+}
+
+// Validates the merge files against the current hash and settings, or
+// starts a new shard file. Exits on any error.
+void ShardInit( const HashInfo * hinfo, bool extra );
+
+// Marks this process's shard file as complete. This must be called only
+// after every test has run.
+void ShardFinish( void );
+
+// Saves a record to this process's shard file, replacing any record of
+// the same name.
+void ShardSave( const std::string & name, const void * data, size_t len );
+void ShardSave( const std::string & name, const std::string & data );
+
+// Returns the contents of all records of the given name from the merge
+// files, in shard index order.
+std::vector<std::string> ShardRecords( const std::string & name );
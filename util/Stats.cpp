@@ -54,6 +54,10 @@
 #include "Platform.h"
 #include "Instantiate.h"
 
+#if defined(HAVE_AVX512_BW)
+  #include "Intrinsics.h"
+#endif
+
 #include <vector>
 #include <algorithm>
 #include <numeric>
@@ -1161,7 +1165,7 @@ double GetMissingHashesExpected( size_t nbH, int nbBits ) {
  * This may validly return a value exceeding the number of hash bits
  * that exist for the hash being tested!
  */
-int GetNLogNBound( unsigned nbH ) {
+int GetNLogNBound( uint64_t nbH ) {
     int nbHBits;
 
     for (nbHBits = 1; nbHBits <= 255; nbHBits++) {
@@ -1374,8 +1378,7 @@ double GetBoundedPoissonPValue( const double expected, const uint64_t collisions
 // Compute the sum of squares of a series of integer values
 // NB: bincount must be a non-zero multiple of 64!
 template <typename T>
-uint64_t sumSquares( const T * bins, size_t bincount ) {
-    static_assert(std::is_integral<T>::value, "sumSquares only uses integer data");
+static uint64_t sumSquaresImpl( const T * bins, size_t bincount ) {
     uint64_t sumsq = 0;
 
     // To allow the compiler to vectorize this loop
@@ -1388,7 +1391,43 @@ uint64_t sumSquares( const T * bins, size_t bincount ) {
     return sumsq;
 }
 
-#define SUMSQ_TYPES uint8_t, uint32_t
+#if defined(HAVE_AVX512_BW)
+
+// Each 64-byte block is widened to 16-bit values and squared-and-summed
+// pairwise by VPMADDWD, leaving 4 squares (< 2^18) per 32-bit lane. The
+// 32-bit lanes are summed into the 64-bit total before they could overflow.
+static uint64_t sumSquaresImpl( const uint8_t * bins, size_t bincount ) {
+    const size_t  BLOCKMAX = 8192;
+    const __m512i ZERO     = _mm512_setzero_si512();
+    uint64_t      sumsq    = 0;
+    uint32_t      lanes[16];
+
+    for (size_t i = 0; i < bincount;) {
+        const size_t blockend = std::min(bincount, i + 64 * BLOCKMAX);
+        __m512i      sum32    = ZERO;
+        for (; i < blockend; i += 64) {
+            __m512i x  = _mm512_loadu_si512((const void *)&bins[i]);
+            __m512i lo = _mm512_unpacklo_epi8(x, ZERO);
+            __m512i hi = _mm512_unpackhi_epi8(x, ZERO);
+            sum32 = _mm512_add_epi32(sum32, _mm512_madd_epi16(lo, lo));
+            sum32 = _mm512_add_epi32(sum32, _mm512_madd_epi16(hi, hi));
+        }
+        _mm512_storeu_si512((void *)lanes, sum32);
+        sumsq = std::accumulate(lanes, lanes + 16, sumsq);
+    }
+
+    return sumsq;
+}
+
+#endif
+
+template <typename T>
+uint64_t sumSquares( const T * bins, size_t bincount ) {
+    static_assert(std::is_integral<T>::value, "sumSquares only uses integer data");
+    return sumSquaresImpl(bins, bincount);
+}
+
+#define SUMSQ_TYPES uint8_t, uint16_t, uint32_t
 INSTANTIATE(sumSquares, SUMSQ_TYPES);
 
 // Compute the sum of squares of a series of integer values
@@ -1484,7 +1523,7 @@ INSTANTIATE(sumSquaresBasic, SUMSQBASIC_TYPES);
 // sqrt(((sumN{(Bi**2)} - M * lambda) / N) * (N / M))
 // sqrt((sumN{(Bi**2)} - M * lambda) / M)
 // sqrt((sumN{(Bi**2)} / M - lambda))
-double calcScore( const uint64_t sumsq, const int bincount, const int keycount ) {
+double calcScore( const uint64_t sumsq, const int bincount, const uint64_t keycount ) {
     const double n      = bincount;
     const double m      = keycount;
     const double lambda = m / n;
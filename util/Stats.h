@@ -68,7 +68,7 @@ double EstimateNbCollisions( const unsigned long nbH, const int nbBits );
 void ReportCollisionEstimates( void );
 double GetMissingHashesExpected( size_t nbH, int nbBits );
 
-int GetNLogNBound( unsigned nbH );
+int GetNLogNBound( uint64_t nbH );
 double ScalePValue( double p_value, unsigned testcount );
 double ScalePValue2N( double p_value, int testbits );
 int GetLog2PValue( double p_value );
@@ -78,7 +78,7 @@ double EstimateMaxCollPValue( const unsigned long nbH, const int nbBits, const i
 double EstimateMaxCollisions( const unsigned long nbH, const int nbBits );
 double GetBoundedPoissonPValue( const double expected, const uint64_t collisions );
 
-// sumSquares() is currently instantiated for uint8_t and uint32_t.
+// sumSquares() is currently instantiated for uint8_t, uint16_t, and uint32_t.
 // See SUMSQ_TYPES in Stats.cpp to expand this as needed.
 // NB: bincount must be a non-zero multiple of 64!
 template <typename T>
@@ -90,7 +90,7 @@ uint64_t sumSquares( const T * bins, size_t bincount );
 template <typename T>
 uint64_t sumSquaresBasic( const T * bins, size_t bincount );
 
-double calcScore( const uint64_t sumsq, const int bincount, const int ballcount );
+double calcScore( const uint64_t sumsq, const int bincount, const uint64_t ballcount );
 double normalizeScore( double score, int scorewidth );
 
 double ChiSqIndepValue( const uint32_t * boxes, size_t total );
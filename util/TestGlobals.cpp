@@ -68,6 +68,10 @@
 // Globally-visible configuration
 HashInfo::endianness g_hashEndian = HashInfo::ENDIAN_DEFAULT;
 uint64_t g_seed = 0;
+uint64_t g_maxMemory = 0;
+thread_local bool g_inParallel = false;
+const char * g_resumeFile = NULL;
+bool g_screenHashes = false;
 
 //--------
 // What each test suite prints upon failure
@@ -76,6 +80,7 @@ const char * g_failstr = "*********FAIL*********\n";
 //--------
 // Overall log2-p-value statistics and test pass/fail counts
 uint32_t g_log2pValueCounts[COUNT_MAX_PVALUE + 2];
+thread_local uint32_t * g_log2pValueCountsLocal = NULL;
 uint32_t g_testPass, g_testFail;
 std::vector<std::pair<const char *, char *>> g_testFailures;
 
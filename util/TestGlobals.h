@@ -27,8 +27,13 @@
 #include "Blob.h"
 
 // A type for indexing into lists of hashes. Using 32-bits saves time and
-// memory but limits tests to 2^32 hashes. This should be fine.
+// memory but limits tests to 2^32 hashes. This should be fine for almost
+// all uses, but it can be changed via the HIDX_64BIT CMake option.
+#if defined(HIDX_64BIT)
+typedef uint64_t hidx_t;
+#else
 typedef uint32_t hidx_t;
+#endif
 
 // A type for a function that displays the given key and seed.
 typedef std::function <void (hidx_t)> KeyFn;
@@ -41,6 +46,28 @@ typedef std::function <void (hidx_t)> KeyFn;
 // is not explicitly part of that test.
 extern seed_t g_seed;
 
+// If non-zero, tests with very large keysets should try to keep the
+// memory used for lists of hashes under this many bytes. See HashSpill.h.
+extern uint64_t g_maxMemory;
+
+// Tests which run several large iterations concurrently keep the total
+// memory used by all of them under this many bytes if g_maxMemory is 0.
+#define DEFAULT_PARALLEL_MEMORY (UINT64_C(2) << 30)
+
+// Set in threads which a test spawned to run its iterations concurrently,
+// so that code which would otherwise start its own threads (RandSeq::write()
+// and TestHashList()) stays single-threaded instead of oversubscribing the
+// CPUs with g_NCPU * g_NCPU threads.
+extern thread_local bool g_inParallel;
+
+// If non-NULL, the BadSeeds search saves its progress to this file as it
+// goes, and resumes from it if it already exists.
+extern const char * g_resumeFile;
+
+// If true, lists of hashes are first screened with cheap approximate
+// tests, and only tested exactly if the result is borderline.
+extern bool g_screenHashes;
+
 // What each test suite prints upon failure
 extern const char * g_failstr;
 
@@ -76,11 +103,24 @@ typedef uint32_t flags_t;
 #define COUNT_MAX_PVALUE 24
 extern uint32_t g_log2pValueCounts[COUNT_MAX_PVALUE + 2];
 
+// Test iterations which are run concurrently point this at their own
+// array of counts, which the test later adds in via
+// mergeLog2PValueCounts(), instead of racing on the global counts.
+extern thread_local uint32_t * g_log2pValueCountsLocal;
+
 static inline void recordLog2PValue( uint32_t log_pvalue ) {
+    uint32_t * counts = (g_log2pValueCountsLocal != NULL) ? g_log2pValueCountsLocal : g_log2pValueCounts;
+
     if (log_pvalue <= COUNT_MAX_PVALUE) {
-        g_log2pValueCounts[log_pvalue]++;
+        counts[log_pvalue]++;
     } else {
-        g_log2pValueCounts[COUNT_MAX_PVALUE + 1]++;
+        counts[COUNT_MAX_PVALUE + 1]++;
+    }
+}
+
+static inline void mergeLog2PValueCounts( const uint32_t * counts ) {
+    for (unsigned i = 0; i < COUNT_MAX_PVALUE + 2; i++) {
+        g_log2pValueCounts[i] += counts[i];
     }
 }
 
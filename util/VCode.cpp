@@ -231,6 +231,60 @@ static inline void crc32c_update( uint32_t * crc, const void * ptr, size_t len )
 #endif
 }
 
+//-----------------------------------------------------------------------------
+// CRC32c combination
+// This is based on Mark Adler's crc32_combine() from zlib.
+//
+// Appending len bytes to a message multiplies its CRC register by
+// x^(8*len) modulo the CRC polynomial, and then XORs in the CRC of those
+// bytes computed from a zero register. The x^(2^n) table lets that
+// multiplier be computed in O(log len) steps. Unlike zlib's CRC-32
+// polynomial, the order of x modulo the CRC32c polynomial does not divide
+// 2^32-1, so the table can't wrap around after 32 entries, and instead it
+// covers every bit of a 64-bit bit count.
+static const uint32_t CRC32C_POLY = 0x82f63b78; // reflected
+static uint32_t       crc32c_x2n_table[64];
+
+static uint32_t crc32c_multmodp( uint32_t a, uint32_t b ) {
+    uint32_t m = UINT32_C(1) << 31;
+    uint32_t p = 0;
+
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b   = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+static void crc32c_x2n_init( void ) {
+    uint32_t p = UINT32_C(1) << 30; // x^1
+
+    crc32c_x2n_table[0] = p;
+    for (int n = 1; n < 64; n++) {
+        crc32c_x2n_table[n] = p = crc32c_multmodp(p, p);
+    }
+}
+
+static uint32_t crc32c_shift( uint32_t crc, uint64_t len ) {
+    uint32_t p = UINT32_C(1) << 31; // x^0
+    unsigned k = 3;                 // x^(2^3) is 1 byte
+
+    while (len) {
+        if (len & 1) {
+            p = crc32c_multmodp(crc32c_x2n_table[k], p);
+        }
+        len >>= 1;
+        k++;
+    }
+    return crc32c_multmodp(p, crc);
+}
+
 //-----------------------------------------------------------------------------
 // CRC implementation self-tests
 template <bool use_hw, bool oneshot>
@@ -306,9 +360,60 @@ static bool vcode_crc_selftest( void ) {
     return true;
 }
 
+// This checks that splitting the same data into chunks, in a few
+// different ways, and then merging them gives the same CRC as a serial
+// computation.
+static bool vcode_combine_selftest( void ) {
+    uint8_t buf[200];
+
+    for (int i = 0; i < 200; i++) {
+        buf[i] = 0x35 + 7 * i;
+    }
+
+    const uint32_t seed = 0x5d7c3b1a;
+    uint32_t serial = seed;
+    crc32c_update(&serial, buf, 200);
+
+    const size_t splits[4] = { 1, 8, 37, 199 };
+    for (size_t i = 0; i < 4; i++) {
+        uint32_t chunk1 = 0, chunk2 = 0;
+        crc32c_update(&chunk1, &buf[0], splits[i]);
+        crc32c_update(&chunk2, &buf[splits[i]], 200 - splits[i]);
+
+        uint32_t merged = seed;
+        merged = crc32c_shift(merged, splits[i]      ) ^ chunk1;
+        merged = crc32c_shift(merged, 200 - splits[i]) ^ chunk2;
+        if (merged != serial) { return false; }
+    }
+
+    // Chunks of 512MiB or more shift by 2^32 bits or more. Those shifts
+    // are checked against plain square-and-multiply, which doesn't use
+    // the x^(2^n) table at all.
+    const uint64_t biglens[4] = {
+        UINT64_C(1) << 29, (UINT64_C(1) << 29) + 199, UINT64_C(0x123456789ab), UINT64_C(-1) >> 3
+    };
+    for (size_t i = 0; i < 4; i++) {
+        uint32_t xpow = UINT32_C(1) << 31; // x^0
+        uint32_t sq   = UINT32_C(1) << 30; // x^1
+        for (int j = 0; j < 3; j++) {
+            sq = crc32c_multmodp(sq, sq);  // x^8, which is 1 byte
+        }
+        for (uint64_t len = biglens[i]; len != 0; len >>= 1) {
+            if (len & 1) {
+                xpow = crc32c_multmodp(sq, xpow);
+            }
+            sq = crc32c_multmodp(sq, sq);
+        }
+        if (crc32c_shift(seed, biglens[i]) != crc32c_multmodp(xpow, seed)) { return false; }
+    }
+
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // VCode internal implementation
 vcode_state_t vcode_states[VCODE_COUNT];
+thread_local vcode_chunk_t * vcode_redirect = NULL;
 uint32_t g_doVCode       = 0;
 uint32_t g_inputVCode    = 1;
 uint32_t g_outputVCode   = 1;
@@ -354,6 +459,8 @@ static uint32_t getDigest( vcode_state_t * state ) {
 static uint32_t VCODE_MASK = 0x0;
 
 void VCODE_INIT( void ) {
+    crc32c_x2n_init();
+
     if (!vcode_crc_selftest<false>()) {
         printf("VCode CRC32c SW self-test failed!\n");
         exit(1);
@@ -364,6 +471,11 @@ void VCODE_INIT( void ) {
         exit(1);
     }
 
+    if (!vcode_combine_selftest()) {
+        printf("VCode CRC32c combine self-test failed!\n");
+        exit(1);
+    }
+
     for (int i = 0; i < VCODE_COUNT; i++) {
         resetWithSeed(&vcode_states[i], i);
     }
@@ -393,9 +505,50 @@ void VCODE_HASH( const void * input, size_t len, unsigned idx ) {
     if (idx >= VCODE_COUNT) {
         return;
     }
+    if (vcode_redirect != NULL) {
+        VCODE_HASH(*vcode_redirect, input, len, idx);
+        return;
+    }
     update(&vcode_states[idx], input, len);
 }
 
+void VCODE_HASH( vcode_chunk_t & chunk, const void * input, size_t len, unsigned idx ) {
+    if (idx >= VCODE_COUNT) {
+        return;
+    }
+    update(&chunk.states[idx], input, len);
+    chunk.data_lens[idx] += len;
+    chunk.lens_lens[idx] += 8;
+}
+
+void VCODE_HASH_PART( vcode_chunk_t & chunk, const void * input, size_t len, unsigned idx ) {
+    if (idx >= VCODE_COUNT) {
+        return;
+    }
+    crc32c_update(&chunk.states[idx].data_hash, input, len);
+    chunk.data_lens[idx] += len;
+}
+
+void VCODE_HASH_LEN( vcode_chunk_t & chunk, uint64_t totallen, unsigned idx ) {
+    if (idx >= VCODE_COUNT) {
+        return;
+    }
+    crc32c_update_u64(&chunk.states[idx].lens_hash, totallen);
+    chunk.lens_lens[idx] += 8;
+}
+
+void VCODE_MERGE( const vcode_chunk_t * chunks, size_t count ) {
+    for (size_t i = 0; i < count; i++) {
+        for (int idx = 0; idx < VCODE_COUNT; idx++) {
+            vcode_state_t *       state = &vcode_states[idx];
+            const vcode_state_t * chunk = &chunks[i].states[idx];
+
+            state->data_hash = crc32c_shift(state->data_hash, chunks[i].data_lens[idx]) ^ chunk->data_hash;
+            state->lens_hash = crc32c_shift(state->lens_hash, chunks[i].lens_lens[idx]) ^ chunk->lens_hash;
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Pre-computed tables for CRC32c
 #if defined(HWCRC_U64)
@@ -73,6 +73,15 @@ typedef struct {
 
 #define VCODE_COUNT 3
 extern vcode_state_t vcode_states[VCODE_COUNT];
+
+// See "Order-independent VCode input handling" below.
+typedef struct {
+    vcode_state_t  states[VCODE_COUNT];
+    uint64_t       data_lens[VCODE_COUNT];
+    uint64_t       lens_lens[VCODE_COUNT];
+} vcode_chunk_t;
+
+extern thread_local vcode_chunk_t * vcode_redirect;
 extern uint32_t      g_doVCode;
 extern uint32_t      g_inputVCode;
 extern uint32_t      g_outputVCode;
@@ -159,10 +168,24 @@ static inline void crc32c_update_u64( uint32_t * crcptr, uint64_t data ) {
 
 //-----------------------------------------------------------------------------
 // Special-case inline-able handling of 8-or-fewer byte integer VCode inputs
+static inline void VCODE_HASH_SMALL( vcode_chunk_t & chunk, const uint64_t data, unsigned idx ) {
+    if (idx >= VCODE_COUNT) {
+        return;
+    }
+    crc32c_update_u64(&chunk.states[idx].data_hash, data);
+    crc32c_update_u64(&chunk.states[idx].lens_hash,    8);
+    chunk.data_lens[idx] += 8;
+    chunk.lens_lens[idx] += 8;
+}
+
 static inline void VCODE_HASH_SMALL( const uint64_t data, unsigned idx ) {
     if (idx >= VCODE_COUNT) {
         return;
     }
+    if (vcode_redirect != NULL) {
+        VCODE_HASH_SMALL(*vcode_redirect, data, idx);
+        return;
+    }
     crc32c_update_u64(&vcode_states[idx].data_hash, data);
     crc32c_update_u64(&vcode_states[idx].lens_hash,    8);
 }
@@ -200,3 +223,70 @@ static inline void addVCodeOutput( const void * in, size_t len ) {
 static inline void addVCodeResult( const void * in, size_t len ) {
     if (g_doVCode) { VCODE_HASH(in, len, 2); }
 }
+
+//-----------------------------------------------------------------------------
+// Order-independent VCode input handling
+//
+// A vcode_chunk_t accumulates one piece of all the VCode streams on its
+// own, so that different pieces can be computed in any order, such as by
+// different threads or by batched keyset generation. Chunks must start
+// zeroed (e.g. "vcode_chunk_t chunk = {}"). Once all of them are done,
+// mergeVCodeChunks() folds them into the VCode streams in array order,
+// which is their logical order. Since CRCs are linear, this gives exactly
+// the same VCodes as adding all of their data serially in that order.
+//
+// Code which can't be given a chunk explicitly, such as TestHashList(),
+// can still be run this way: while a thread's vcode_redirect points to a
+// chunk, every non-chunk addVCode*() call made by that thread goes into
+// that chunk instead of the global VCode streams.
+//
+// One logical input can also be added to a chunk in several pieces, via
+// VCODE_HASH_PART() for each piece followed by one VCODE_HASH_LEN() call
+// with their total length. This gives the same chunk as one VCODE_HASH()
+// call over all of the pieces at once.
+void VCODE_HASH( vcode_chunk_t & chunk, const void * input, size_t len, unsigned idx );
+void VCODE_HASH_PART( vcode_chunk_t & chunk, const void * input, size_t len, unsigned idx );
+void VCODE_HASH_LEN( vcode_chunk_t & chunk, uint64_t totallen, unsigned idx );
+void VCODE_MERGE( const vcode_chunk_t * chunks, size_t count );
+
+template <typename T>
+static inline void addVCodeInput( vcode_chunk_t & chunk, const T data ) {
+    static_assert(std::is_integral<T>::value, "Non-integer data requires addVCode(const void *, size_t)");
+    if (g_doVCode) { VCODE_HASH_SMALL(chunk, (uint64_t)data, 0); }
+}
+
+template <typename T>
+static inline void addVCodeOutput( vcode_chunk_t & chunk, const T data ) {
+    static_assert(std::is_integral<T>::value, "Non-integer data requires addVCode(const void *, size_t)");
+    if (g_doVCode) { VCODE_HASH_SMALL(chunk, (uint64_t)data, 1); }
+}
+
+template <typename T>
+static inline void addVCodeResult( vcode_chunk_t & chunk, const T data ) {
+    static_assert(std::is_integral<T>::value, "Non-integer data requires addVCode(const void *, size_t)");
+    if (g_doVCode) { VCODE_HASH_SMALL(chunk, (uint64_t)data, 2); }
+}
+
+static inline void addVCodeInput( vcode_chunk_t & chunk, const void * in, size_t len ) {
+    if (g_doVCode) { VCODE_HASH(chunk, in, len, 0); }
+}
+
+static inline void addVCodeOutput( vcode_chunk_t & chunk, const void * in, size_t len ) {
+    if (g_doVCode) { VCODE_HASH(chunk, in, len, 1); }
+}
+
+static inline void addVCodeResult( vcode_chunk_t & chunk, const void * in, size_t len ) {
+    if (g_doVCode) { VCODE_HASH(chunk, in, len, 2); }
+}
+
+static inline void addVCodeOutputPart( vcode_chunk_t & chunk, const void * in, size_t len ) {
+    if (g_doVCode) { VCODE_HASH_PART(chunk, in, len, 1); }
+}
+
+static inline void addVCodeOutputLen( vcode_chunk_t & chunk, uint64_t totallen ) {
+    if (g_doVCode) { VCODE_HASH_LEN(chunk, totallen, 1); }
+}
+
+static inline void mergeVCodeChunks( const vcode_chunk_t * chunks, size_t count ) {
+    if (g_doVCode) { VCODE_MERGE(chunks, count); }
+}
@@ -46,49 +46,109 @@
 
 #include <vector>
 #include <string>
-#include <algorithm>
-#include <unordered_set>
 
 #include "Wordlist.h"
 #include "words/array.h"
 
-std::vector<std::string> GetWordlist( wordlist_case_t cases, bool verbose ) {
-    std::vector<std::string> wordvec;
-    std::unordered_set<std::string> wordset; // words need to be unique, otherwise we report collisions
-    unsigned sum = 0, skip_dup = 0, skip_char = 0;
-
-    for (const char* cstr : words_array) {
-        std::string  str = cstr;
-        if (str.find_first_not_of("abcdefghijklmnopqrstuvwxyz") != std::string::npos) {
-            skip_char++;
-            continue;
-        } else if (wordset.count(str) > 0) {
-            skip_dup++;
-            continue;
-        }
-        wordvec.push_back(str);
-        if ((cases == CASE_LOWER_SINGLE) || (cases == CASE_ALL)) {
-            std::transform(str.begin(), str.begin() + 1, str.begin(), ::toupper);
-            wordvec.push_back(str);
+// The internal list is validated and case-expanded exactly once per
+// process, into a single packed buffer. Each accepted word is stored as
+// its lower-case, Single-case, and UPPER-case forms back-to-back, so one
+// offset table serves every wordlist_case_t. offsets[] has one extra
+// trailing entry so that each word's length is implied by its neighbor.
+struct PackedWordlist {
+    std::vector<char>      blob;
+    std::vector<uint32_t>  offsets;
+    unsigned               skip_dup;
+    unsigned               skip_char;
+    uint64_t               sumlen;
+
+    PackedWordlist( void ) : skip_dup( 0 ), skip_char( 0 ), sumlen( 0 ) {
+        const size_t count = sizeof(words_array) / sizeof(words_array[0]);
+        size_t       total = 0;
+
+        for (const char * cstr: words_array) {
+            total += strlen(cstr);
         }
-        if ((cases == CASE_LOWER_UPPER) || (cases == CASE_ALL)) {
-            std::transform(str.begin(), str.end(), str.begin(), ::toupper);
-            wordvec.push_back(str);
+        blob.reserve(total * 3);
+        offsets.reserve(count + 1);
+
+        const char * prev    = "";
+        size_t       prevlen = 0;
+        for (const char * cstr: words_array) {
+            const size_t len = strlen(cstr);
+            bool         ok  = true;
+            for (size_t j = 0; j < len; j++) {
+                ok &= (cstr[j] >= 'a') && (cstr[j] <= 'z');
+            }
+            if (!ok) {
+                skip_char++;
+                continue;
+            }
+            // words need to be unique, otherwise we report collisions. The
+            // internal list is sorted, so any duplicates are adjacent.
+            if ((len == prevlen) && (memcmp(cstr, prev, len) == 0)) {
+                skip_dup++;
+                continue;
+            }
+            prev = cstr; prevlen = len;
+
+            offsets.push_back((uint32_t)blob.size());
+            blob.insert(blob.end(), cstr, cstr + len);
+            blob.push_back(cstr[0] - 'a' + 'A');
+            blob.insert(blob.end(), cstr + 1, cstr + len);
+            for (size_t j = 0; j < len; j++) {
+                blob.push_back(cstr[j] - 'a' + 'A');
+            }
+            sumlen += len;
         }
-        sum += str.size();
+        offsets.push_back((uint32_t)blob.size());
     }
+};
+
+static const PackedWordlist & GetPackedWordlist( void ) {
+    static const PackedWordlist packed;
+
+    return packed;
+}
+
+std::vector<std::string> Wordlist::strings( void ) const {
+    std::vector<std::string> wordvec;
 
-    if ((skip_dup > 0) || (skip_char > 0)) {
+    wordvec.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        const wordlist_word_t w = (*this)[i];
+        wordvec.emplace_back(w.ptr, w.len);
+    }
+
+    return wordvec;
+}
+
+Wordlist GetWordlist( wordlist_case_t cases, bool verbose ) {
+    const PackedWordlist & packed = GetPackedWordlist();
+    Wordlist words;
+
+    words.blob    = packed.blob.data();
+    words.offsets = packed.offsets.data();
+    words.nwords  = packed.offsets.size() - 1;
+    words.ncases  = 0;
+    words.variants[words.ncases++] = 0;
+    if ((cases == CASE_LOWER_SINGLE) || (cases == CASE_ALL)) {
+        words.variants[words.ncases++] = 1;
+    }
+    if ((cases == CASE_LOWER_UPPER) || (cases == CASE_ALL)) {
+        words.variants[words.ncases++] = 2;
+    }
+
+    if ((packed.skip_dup > 0) || (packed.skip_char > 0)) {
         fprintf(stderr, "WARNING: skipped %d bad internal words (%d dupes, %d from invalid chars)\n",
-                skip_dup + skip_char, skip_dup, skip_char);
+                packed.skip_dup + packed.skip_char, packed.skip_dup, packed.skip_char);
     }
 
     if (verbose) {
-        unsigned cnt = (double)wordvec.size() /
-            ((cases == CASE_ALL) ? 3.0 : (cases == CASE_LOWER) ? 1.0 : 2.0);
+        unsigned cnt = words.nwords;
         printf("Read %d words from internal list, ", cnt);
-        printf("avg len: %0.3f\n\n", (double)(sum) / (double)(cnt));
+        printf("avg len: %0.3f\n\n", (double)(packed.sumlen) / (double)(cnt));
     }
 
-    return wordvec;
+    return words;
 }
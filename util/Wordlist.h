@@ -18,6 +18,7 @@
  */
 
 #include <string>
+#include <vector>
 
 // The list of words in all lower-case are always returned. In addition,
 // the list may include the same words in all upper-case and/or the same
@@ -29,4 +30,38 @@ typedef enum {
     CASE_ALL          = 3
 } wordlist_case_t;
 
-std::vector<std::string> GetWordlist( wordlist_case_t cases, bool verbose );
+// A view of one word. The bytes are NOT NUL-terminated.
+struct wordlist_word_t {
+    const char *  ptr;
+    uint32_t      len;
+};
+
+// A read-only view over the packed internal wordlist. All Wordlist
+// objects share the same backing storage, which is built once per
+// process and never freed, so they are cheap to copy and return.
+class Wordlist {
+  public:
+    size_t size( void ) const { return nwords * ncases; }
+
+    wordlist_word_t operator [] ( size_t i ) const {
+        const size_t   word = i / ncases;
+        const uint32_t off  = offsets[word];
+        const uint32_t len  = (offsets[word + 1] - off) / 3;
+
+        return { blob + off + len * variants[i % ncases], len };
+    }
+
+    // For callers which need owning copies (e.g. as container keys)
+    std::vector<std::string> strings( void ) const;
+
+  private:
+    friend Wordlist GetWordlist( wordlist_case_t cases, bool verbose );
+
+    const char *      blob;
+    const uint32_t *  offsets;
+    size_t            nwords;
+    unsigned          ncases;
+    uint8_t           variants[3];
+};
+
+Wordlist GetWordlist( wordlist_case_t cases, bool verbose );